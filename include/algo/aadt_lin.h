@@ -3,12 +3,17 @@
 #include <algorithm>
 #include <bit>
 #include <cstdint>
-#include <stack>
+#include <deque>
+#include <memory_resource>
+#include <optional>
+#include <string>
 #include <type_traits>
 #include <utility>
 
+#include "arena.h"
 #include "definitions.h"
 #include "fptlinutils.h"
+#include "monitor_context.h"
 
 namespace fptlin {
 
@@ -21,16 +26,77 @@ concept aadt_impl = std::is_default_constructible_v<aadt_impl_t> &&
                       { x.undo(o) } -> std::same_as<void>;
                     };
 
+// models may also tell which operations commute: `independent(a, b)` only if,
+// from every state, applying `a` then `b` succeeds exactly when applying `b`
+// then `a` does, and leaves the same state
+template <typename aadt_impl_t, typename value_type>
+concept aadt_independence = requires(const operation_t<value_type>* a,
+                                     const operation_t<value_type>* b) {
+  { aadt_impl_t::independent(a, b) } -> std::same_as<bool>;
+};
+
 template <typename value_type, aadt_impl<value_type> aadt_impl_t>
 struct impl {
  public:
-  bool is_linearizable(history_t<value_type>& hist) {
-    events = get_events(hist);
-    std::sort(events.begin(), events.end());
-    pattern = get_bit_pattern(events);
-    return dfs({0, 0});
+  // `memory` as `monitor_context::memory` of the checks
+  explicit impl(
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : visited(memory) {}
+
+  // from the state `model` rather than a fresh object
+  explicit impl(
+      aadt_impl_t model,
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : visited(memory), obj_impl(std::move(model)) {}
+
+  bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+    require_proc_bits(hist);
+    {
+      scoped_phase phase(ctx.stats, Phase::SORT);
+      events = get_events(hist);
+      std::sort(events.begin(), events.end());
+      pattern = get_bit_pattern(events);
+    }
+
+    if (ctx.limits.mem_limit) cache.emplace(ctx.limits.mem_limit);
+    ctx.progress.layers = events.size();
+
+    base = hist.data();
+    uint64_t hist_fingerprint = ctx.checkpointing() || ctx.resume
+                                    ? fingerprint(hist)
+                                    : 0;
+    if (auto state = ctx.take_resume(Engine::AADT, hist_fingerprint)) {
+      restore(*state);
+      if (!frames.empty()) ctx.reach(frames.back().v.layer);
+    } else
+      frames.push_back(frame_t{node{0, 0}});
+
+    // also of searches that run out of budget
+    auto count = [&] {
+      if (cache) {
+        ctx.stats.add(Counter::NODES_VISITED, cache->inserted);
+        ctx.stats.add(Counter::NODES_EVICTED, cache->evicted);
+      } else {
+        ctx.stats.add(Counter::NODES_VISITED, visited->size());
+      }
+    };
+    scoped_phase phase(ctx.stats, Phase::SEARCH);
+    bool res;
+    try {
+      res = dfs(ctx, hist_fingerprint);
+    } catch (const budget_exhausted&) {
+      if (ctx.checkpointing())
+        ctx.save_checkpoint(Engine::AADT, hist_fingerprint, save());
+      count();
+      throw;
+    }
+    count();
+    return res;
   }
 
+  // the state of the object after the linearization found, if any
+  const aadt_impl_t& model() const { return obj_impl; }
+
  private:
   struct frame_t {
     node v;
@@ -40,7 +106,7 @@ struct impl {
     uint32_t res_bit = 0;
     uint32_t inv_bit = 0;
 
-    // intra-layer iterator state: bits remaining to try
+    // intra-layer iterator state: bits remaining to try, see `persistent`
     uint32_t intra_remaining = 0;
 
     // bookkeeping to emulate recursive apply/undo and inter-layer side-effects
@@ -52,30 +118,37 @@ struct impl {
         false;  // whether inter child was pushed and we must restore afterward
   };
 
-  bool dfs(node start) {
-    std::stack<frame_t> st;
-    st.push(frame_t{start});
+  // the state between iterations is consistent, and may be saved, as long as
+  // `step` is called before a frame changes
+  bool dfs(monitor_context& ctx, uint64_t hist_fingerprint) {
+    std::deque<frame_t>& st = frames;
 
     while (!st.empty()) {
-      frame_t& f = st.top();
+      if (ctx.checkpoint_due)
+        ctx.save_checkpoint(Engine::AADT, hist_fingerprint, save());
+
+      frame_t& f = st.back();
 
       // --- entering logic (once per frame) ---
       if (!f.entered) {
         // base case
         if (std::cmp_equal(f.v.layer, events.size())) return true;
 
+        ctx.step();
+
         // attempt to mark visited
-        if (!visited.insert(f.v).second) {
-          st.pop();
+        if (!(cache ? cache->insert(f.v) : visited->insert(f.v).second)) {
+          st.pop_back();
           continue;
         }
+        ctx.reach(f.v.layer);
 
         // populate layer-specific pattern
         auto [mb, rb, ib] = pattern[f.v.layer];
         f.max_bit = mb;
         f.res_bit = rb;
         f.inv_bit = ib;
-        f.intra_remaining = f.max_bit;
+        f.intra_remaining = persistent(f);
         f.applied_op = nullptr;
         f.entered = true;
         f.inter_pushed_restore = false;
@@ -104,7 +177,7 @@ struct impl {
 
         if (obj_impl.apply(to_add)) {
           f.applied_op = to_add;
-          st.push(frame_t{node{f.v.layer, f.v.bits | curr_bit}});
+          st.push_back(frame_t{node{f.v.layer, f.v.bits | curr_bit}});
           pushed_child = true;
           break;  // break intra loop; child will be processed next iteration
         }
@@ -118,7 +191,7 @@ struct impl {
         // cannot advance; `v.bits` doesn't satisfy `res_bit` -> pop and
         // backtrack
         if (f.res_bit & ~f.v.bits) {
-          st.pop();
+          st.pop_back();
           continue;
         }
 
@@ -130,7 +203,7 @@ struct impl {
         // push the next-layer child and continue
         node next{f.v.layer + 1, f.v.bits ^ f.res_bit};
         f.inter_pushed_restore = true;
-        st.push(frame_t{next});
+        st.push_back(frame_t{next});
         continue;
       }
 
@@ -141,20 +214,132 @@ struct impl {
       }
 
       // finished exploring frame -> pop and backtrack
-      st.pop();
+      st.pop_back();
     }
 
     return false;  // exhausted all reachable states
   }
 
+  /**
+   * Pending operations whose successors suffice to find a linearization from
+   * `f`, if any, as long as they are tried in every frame.
+   *
+   * Advancing past an event commutes with linearizing any pending operation,
+   * so none needs to be tried unless the event is the response of one not yet
+   * linearized. That one must be linearized in this layer, and may be moved
+   * before every operation independent of it, so only those it depends on
+   * need to be tried, and those they depend on in turn. Of alike ones, only
+   * the one responding first is, see `alike_before`.
+   */
+  uint32_t persistent(const frame_t& f) const {
+    uint32_t pending = f.max_bit & ~f.v.bits;
+    if (!(f.res_bit & pending)) return 0;
+
+    uint32_t set = pending;
+    if constexpr (aadt_independence<aadt_impl_t, value_type>) {
+      set = f.res_bit;
+      for (uint32_t todo = set; todo;) {
+        const operation_t<value_type>* t = ongoing[std::countr_zero(todo)];
+        todo &= todo - 1;
+        for (uint32_t rest = pending & ~set; rest; rest &= rest - 1) {
+          uint32_t bit = rest & -rest;
+          if (!aadt_impl_t::independent(t, ongoing[std::countr_zero(bit)])) {
+            set |= bit;
+            todo |= bit;
+          }
+        }
+      }
+    }
+
+    uint32_t before[MAX_PROC_NUM];
+    alike_before(set, ongoing, before);
+    uint32_t ret = set;
+    for (uint32_t x = set; x; x &= x - 1)
+      if (before[std::countr_zero(x)] & set) ret &= ~(x & -x);
+    return ret;
+  }
+
+  /**
+   * The object is not saved, as it is the result of applying the operations
+   * applied by the frames, in order.
+   */
+  std::string save() const {
+    checkpoint_writer w;
+    w.put(events.size());
+    w.put(frames.size());
+    for (const frame_t& f : frames) {
+      w.put(f.v.layer);
+      w.put(f.v.bits);
+      w.put(f.intra_remaining);
+      w.put(index(f.applied_op));
+      w.put(f.entered);
+      w.put(f.inter_pushed_restore);
+    }
+    for (operation_t<value_type>* o : ongoing) w.put(index(o));
+
+    if (cache) {
+      std::vector<node> nodes = cache->nodes();
+      w.put(nodes.size());
+      for (node v : nodes) w.put(std::tuple{v.layer, v.bits});
+    } else {
+      w.put(visited->size());
+      for (node v : *visited) w.put(std::tuple{v.layer, v.bits});
+    }
+    return w.data;
+  }
+
+  void restore(const std::string& state) {
+    checkpoint_reader r(state);
+    if (r.get<std::size_t>() != events.size())
+      throw std::invalid_argument("Checkpoint is of another history");
+    for (std::size_t n = r.get<std::size_t>(); n; --n) {
+      frame_t f{node{r.get<int>(), r.get<uint32_t>()}};
+      f.intra_remaining = r.get<uint32_t>();
+      f.applied_op = op(r.get<std::size_t>());
+      f.entered = r.get<bool>();
+      f.inter_pushed_restore = r.get<bool>();
+      if (f.entered) {
+        auto [mb, rb, ib] = pattern[f.v.layer];
+        f.max_bit = mb;
+        f.res_bit = rb;
+        f.inv_bit = ib;
+      }
+      if (f.applied_op && !obj_impl.apply(f.applied_op))
+        throw std::invalid_argument("Checkpoint is inconsistent");
+      frames.push_back(f);
+    }
+    for (operation_t<value_type>*& o : ongoing) o = op(r.get<std::size_t>());
+
+    std::size_t n = r.get<std::size_t>();
+    if (!cache) visited->reserve(n);
+    for (; n; --n) {
+      auto [layer, bits] = r.get<std::tuple<int, uint32_t>>();
+      if (cache)
+        cache->insert({layer, bits});
+      else
+        visited->insert({layer, bits});
+    }
+  }
+
+  // positions in the history, 0 for none
+  std::size_t index(const operation_t<value_type>* o) const {
+    return o ? o - base + 1 : 0;
+  }
+  operation_t<value_type>* op(std::size_t i) const {
+    return i ? base + (i - 1) : nullptr;
+  }
+
   // global states
   events_t<value_type> events;
   std::vector<bit_pattern> pattern;
-  node_set visited;
+  arena_held<node_set> visited;
+  std::optional<node_cache> cache;  // replaces `visited` under a memory limit
+  operation_t<value_type>* base = nullptr;  // of the history
 
   // local states
+  std::deque<frame_t> frames;
   aadt_impl_t obj_impl;
-  operation_t<value_type>* ongoing[MAX_PROC_NUM];
+  operation_t<value_type>* ongoing[MAX_PROC_NUM]{};
 };
 
 }  // namespace aadt
@@ -3,6 +3,7 @@
 #include "priorityqueue_lin.h"
 #include "queue_lin.h"
 #include "rmw_lin.h"
+#include "rw_register_lin.h"
 #include "semaphore_lin.h"
 #include "set_lin.h"
-#include "stack_lin.h"
\ No newline at end of file
+#include "stack_lin.h"
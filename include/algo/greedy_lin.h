@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "aadt_lin.h"
+#include "monitor_context.h"
+
+namespace fptlin {
+
+namespace greedy {
+
+// number of unplaced operations inspected at each step of a candidate order
+constexpr std::size_t WINDOW = 8;
+
+/**
+ * Cheap, incomplete first attempt at linearizing a history.
+ *
+ * Operations are placed one at a time without backtracking. At each step the
+ * next `WINDOW` unplaced operations of a candidate order (end time, then start
+ * time) are tried, and the first one that is minimal w.r.t. real-time order
+ * and accepted by the sequential model is placed. O(n log n + WINDOW * n).
+ *
+ * Returns `true` only if a linearization is found, `false` is inconclusive.
+ */
+template <typename value_type, aadt::aadt_impl<value_type> model_t>
+struct impl {
+  using op_ptr = operation_t<value_type>*;
+
+ public:
+  impl() = default;
+
+  // from the state `model` rather than a fresh object
+  explicit impl(const model_t& model) : model(model) {}
+
+  bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+    scoped_phase phase(ctx.stats, Phase::GREEDY);
+    if (hist.empty()) return true;
+
+    std::vector<op_ptr> by_end, by_start;
+    by_end.reserve(hist.size());
+    for (auto& o : hist) by_end.push_back(&o);
+    by_start = by_end;
+
+    std::sort(by_end.begin(), by_end.end(), [](op_ptr a, op_ptr b) {
+      return std::pair{a->endTime, a->startTime} <
+             std::pair{b->endTime, b->startTime};
+    });
+    std::sort(by_start.begin(), by_start.end(), [](op_ptr a, op_ptr b) {
+      return std::pair{a->startTime, a->endTime} <
+             std::pair{b->startTime, b->endTime};
+    });
+
+    base = hist.data();
+    return attempt(by_end, by_end) || attempt(by_start, by_end);
+  }
+
+  // the state of the object after the linearization found, if any
+  model_t model{};
+
+ private:
+  // unplaced operations of an order, as a linked list over positions
+  struct order_list {
+    order_list(const std::vector<op_ptr>& ops, op_ptr base)
+        : ops(ops), next(ops.size()), prev(ops.size()), pos(ops.size()) {
+      for (std::size_t i = 0; i < ops.size(); ++i) {
+        next[i] = i + 1;
+        prev[i] = i - 1;
+        pos[ops[i] - base] = i;
+      }
+    }
+
+    void erase(std::size_t i) {
+      if (i == head)
+        head = next[i];
+      else
+        next[prev[i]] = next[i];
+      if (next[i] < ops.size()) prev[next[i]] = prev[i];
+    }
+
+    const std::vector<op_ptr>& ops;
+    std::vector<std::size_t> next, prev, pos;
+    std::size_t head = 0;
+  };
+
+  bool attempt(const std::vector<op_ptr>& order,
+               const std::vector<op_ptr>& by_end) {
+    model_t obj = model;
+    order_list cands(order, base), ends(by_end, base);
+
+    for (std::size_t placed = 0; placed < order.size(); ++placed) {
+      // an operation is minimal iff it starts before every unplaced one ends
+      op_ptr first_end = ends.ops[ends.head];
+      time_type min_end = first_end->endTime;
+
+      op_ptr chosen = nullptr;
+      std::size_t tried = 0;
+      for (std::size_t i = cands.head; i < order.size() && tried < WINDOW;
+           i = cands.next[i], ++tried) {
+        op_ptr o = order[i];
+        if (o != first_end && o->startTime >= min_end) continue;
+        if (obj.apply(o)) {
+          chosen = o;
+          break;
+        }
+      }
+      if (!chosen) return false;
+
+      cands.erase(cands.pos[chosen - base]);
+      ends.erase(ends.pos[chosen - base]);
+    }
+    model = std::move(obj);
+    return true;
+  }
+
+  op_ptr base;
+};
+
+template <typename value_type, aadt::aadt_impl<value_type> model_t>
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+  return impl<value_type, model_t>().is_linearizable(hist, ctx);
+}
+
+// from the state `model`, which is left in the state after `hist` if a
+// linearization is found
+template <typename value_type, aadt::aadt_impl<value_type> model_t>
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx,
+                     model_t& model) {
+  impl<value_type, model_t> greedy(model);
+  if (!greedy.is_linearizable(hist, ctx)) return false;
+  model = std::move(greedy.model);
+  return true;
+}
+
+}  // namespace greedy
+
+}  // namespace fptlin
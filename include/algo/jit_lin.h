@@ -0,0 +1,387 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+#include "aadt_lin.h"
+#include "arena.h"
+#include "monitor_context.h"
+
+namespace fptlin {
+
+namespace jit {
+
+// models whose state depends on the order operations are applied in, e.g. a
+// stack, expose it so that the search tells configurations apart by it; the
+// state of other models is that of the operations applied
+template <typename model_t>
+concept ordered_model = requires(const model_t& m) {
+  { m.state() } -> std::ranges::forward_range;
+};
+
+/**
+ * Wing & Gong's search for a linearization, with Lowe's just-in-time
+ * linearization and memoization of the configurations visited.
+ *
+ * Operations are linearized one at a time, each only while it is minimal, i.e.
+ * invoked before every operation not yet linearized responds, and the search
+ * backtracks at the first response of an operation not yet linearized. A
+ * configuration is the set of operations linearized, along with the state of
+ * an `ordered_model`; one seen before is not explored again.
+ *
+ * Exponential in the number of operations that may take effect in many
+ * orders, rather than in the number of processes as the other exact engines
+ * are, so that histories of many processes whose values mostly fix the order
+ * are decided with little backtracking.
+ */
+// of the configurations remembered when the engine of the data type does not
+// take the history for its processes, so that no other bound applies, and
+// `--mem-limit` is not given
+inline constexpr std::size_t FALLBACK_MEM_LIMIT = std::size_t(512) << 20;
+
+// the bytes of configurations remembered in checking `hist`, 0 for unbounded
+template <typename value_type>
+std::size_t mem_limit(const history_t<value_type>& hist,
+                      const monitor_context& ctx) {
+  if (ctx.limits.mem_limit || fits_proc_bits(hist)) return ctx.limits.mem_limit;
+  return FALLBACK_MEM_LIMIT;
+}
+
+template <typename value_type, aadt::aadt_impl<value_type> model_t>
+struct impl {
+ public:
+  // `memory` as `monitor_context::memory` of the checks, but for an `arena` to
+  // hold nothing else under a `mem_limit`, as it is reset on forgetting
+  explicit impl(
+      model_t model = {},
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : obj(std::move(model)), visited(memory) {}
+
+  bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+    if (hist.empty()) return true;
+    limit = mem_limit(hist, ctx);
+    {
+      scoped_phase phase(ctx.stats, Phase::SORT);
+      // operations are numbered in order of invocation, so that those
+      // linearized form a prefix but for a short window
+      std::sort(hist.begin(), hist.end(), [](const auto& a, const auto& b) {
+        return std::pair{a.startTime, a.endTime} <
+               std::pair{b.startTime, b.endTime};
+      });
+      link(hist);
+    }
+    ctx.progress.layers = hist.size();
+
+    // also of searches that run out of budget
+    auto count = [&] {
+      ctx.stats.add(Counter::NODES_VISITED, inserted);
+      ctx.stats.add(Counter::NODES_EVICTED, evicted);
+    };
+    scoped_phase phase(ctx.stats, Phase::SEARCH);
+    bool res;
+    try {
+      res = search(hist, ctx);
+    } catch (const budget_exhausted&) {
+      count();
+      throw;
+    }
+    count();
+    return res;
+  }
+
+  // the state after the linearization found, if any
+  const model_t& model() const { return obj; }
+
+ private:
+  using state_t = std::conditional_t<ordered_model<model_t>,
+                                     std::pmr::vector<value_type>,
+                                     std::monostate>;
+
+  struct config {
+    uint64_t hash;
+
+    // of the operations linearized, those before `low` all are
+    std::size_t low;
+    std::pmr::vector<uint64_t> window;
+
+    state_t state;
+
+    bool operator==(const config& other) const {
+      return low == other.low && window == other.window &&
+             state == other.state;
+    }
+  };
+
+  struct config_hash {
+    std::size_t operator()(const config& c) const noexcept { return c.hash; }
+  };
+
+  // the calls and responses of `hist`, as a list in sorted order between the
+  // sentinels `HEAD` and `TAIL`, with the call of operation i at `2 * i` and
+  // its response at `2 * i + 1`
+  void link(history_t<value_type>& hist) {
+    std::size_t n = hist.size();
+    events_t<value_type> events = get_events(hist);
+    std::sort(events.begin(), events.end());
+
+    next.assign(2 * n + 2, 0);
+    prev.assign(2 * n + 2, 0);
+    std::size_t last = HEAD(n);
+    for (auto [time, is_inv, optr] : events) {
+      std::size_t e = 2 * (optr - hist.data()) + !is_inv;
+      next[last] = e;
+      prev[e] = last;
+      last = e;
+    }
+    next[last] = TAIL(n);
+    prev[TAIL(n)] = last;
+
+    bits.assign((n + 63) / 64, 0);
+    low = high = 0;
+    hash = 0;
+  }
+
+  // removes operation i from the list, or puts it back
+  void lift(std::size_t i) {
+    for (std::size_t e : {2 * i, 2 * i + 1}) {
+      next[prev[e]] = next[e];
+      prev[next[e]] = prev[e];
+    }
+  }
+  void unlift(std::size_t i) {
+    for (std::size_t e : {2 * i + 1, 2 * i}) {
+      next[prev[e]] = e;
+      prev[next[e]] = e;
+    }
+  }
+
+  void flip(std::size_t i) {
+    std::size_t w = i / 64;
+    bits[w] ^= uint64_t(1) << (i % 64);
+    hash ^= zobrist(i);
+    if (bits[w] >> (i % 64) & 1)
+      high = std::max(high, w + 1);
+    else
+      low = std::min(low, w);
+  }
+
+  static uint64_t zobrist(uint64_t i) {
+    uint64_t h = i + 0x9e3779b97f4a7c15;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+    return h ^ (h >> 31);
+  }
+
+  // the current configuration, returning whether it is new
+  bool visit() {
+    while (low < bits.size() && !~bits[low]) ++low;
+    high = std::max(high, low);
+    while (high > low && !bits[high - 1]) --high;
+
+    probe.hash = hash;
+    probe.low = low;
+    probe.window.assign(bits.begin() + low, bits.begin() + high);
+    if constexpr (ordered_model<model_t>) {
+      probe.state.clear();
+      for (const auto& v : obj.state()) {
+        probe.state.push_back(v);
+        probe.hash = (probe.hash ^ std::hash<value_type>{}(v)) * 0x100000001b3;
+      }
+    }
+    // copied only once new, as `visited` may be in an arena, which frees
+    // nothing until the end
+    if (visited->contains(probe)) return false;
+
+    std::size_t bytes = sizeof(config) + 2 * sizeof(void*) +
+                        probe.window.size() * sizeof(uint64_t);
+    if constexpr (ordered_model<model_t>)
+      bytes += probe.state.size() * sizeof(value_type);
+    // forgetting configurations only costs exploring them again
+    if (limit && visited_bytes + bytes > limit) {
+      evicted += visited->size();
+      visited.clear();
+      visited_bytes = 0;
+    }
+    // members are constructed in place, as assigning a pmr container keeps
+    // the memory of the one assigned to
+    auto alloc = visited->get_allocator();
+    auto state = [&] {
+      if constexpr (ordered_model<model_t>)
+        return state_t(probe.state, alloc);
+      else
+        return state_t{};
+    };
+    visited->insert(config{probe.hash, probe.low,
+                           std::pmr::vector<uint64_t>(probe.window, alloc),
+                           state()});
+    visited_bytes += bytes;
+    ++inserted;
+    return true;
+  }
+
+  bool search(history_t<value_type>& hist, monitor_context& ctx) {
+    const std::size_t n = hist.size();
+    std::vector<std::size_t> linearized;
+    linearized.reserve(n);
+
+    std::size_t e = next[HEAD(n)];
+    while (e != TAIL(n)) {
+      ctx.step();
+      std::size_t i = e / 2;
+      if (!(e & 1)) {
+        operation_t<value_type>* o = &hist[i];
+        if (obj.apply(o)) {
+          flip(i);
+          if (visit()) {
+            linearized.push_back(i);
+            ctx.reach(linearized.size());
+            lift(i);
+            e = next[HEAD(n)];
+            continue;
+          }
+          flip(i);
+          obj.undo(o);
+        }
+        e = next[e];
+        continue;
+      }
+
+      // the response of an operation not linearized
+      if (linearized.empty()) return false;
+      i = linearized.back();
+      linearized.pop_back();
+      flip(i);
+      obj.undo(&hist[i]);
+      unlift(i);
+      e = next[2 * i];
+    }
+    return true;
+  }
+
+  static constexpr std::size_t HEAD(std::size_t n) { return 2 * n; }
+  static constexpr std::size_t TAIL(std::size_t n) { return 2 * n + 1; }
+
+  model_t obj;
+
+  std::vector<std::size_t> next, prev;
+
+  // of the operations linearized, words `[0, low)` are full and `[high, ..)`
+  // empty
+  std::vector<uint64_t> bits;
+  std::size_t low = 0, high = 0;
+  uint64_t hash = 0;
+
+  // the current configuration, to look up
+  config probe{};
+  arena_held<std::pmr::unordered_set<config, config_hash>> visited;
+  std::size_t limit = 0, visited_bytes = 0;
+  uint64_t inserted = 0, evicted = 0;
+};
+
+// from the state `model`, which is left in the state after `hist` if a
+// linearization is found
+template <typename value_type, aadt::aadt_impl<value_type> model_t>
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx,
+                     model_t& model) {
+  ctx.engine = Engine::JIT;
+  // configurations evicted past the limit are freed with an arena of their own
+  std::optional<arena> pool;
+  if (std::size_t limit = mem_limit(hist, ctx)) pool.emplace(limit);
+  impl<value_type, model_t> search(model, pool ? &*pool : ctx.memory);
+  if (!search.is_linearizable(hist, ctx)) return false;
+  model = search.model();
+  return true;
+}
+
+template <typename value_type, aadt::aadt_impl<value_type> model_t>
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+  model_t model;
+  return is_linearizable(hist, ctx, model);
+}
+
+// of `preferred`, the log2 of the cost over which the bound of another engine
+// is out of reach, about a second
+inline constexpr double BUDGET = 29;
+
+/**
+ * Whether `hist` is to be checked by this search rather than by the engine of
+ * its type whatever their costs, if known: as `ctx.strategy` says, but never
+ * when checkpointing or resuming, which only the other engines do, and always
+ * for histories of more processes than those take.
+ */
+template <typename value_type>
+std::optional<bool> chosen(const history_t<value_type>& hist,
+                           const monitor_context& ctx) {
+  if (ctx.checkpointing() || ctx.resume) return false;
+  if (ctx.strategy != Strategy::AUTO) return ctx.strategy == Strategy::JIT;
+  if (hist.empty()) return false;
+  // the other engines have a bit per process
+  if (!fits_proc_bits(hist)) return true;
+  return std::nullopt;
+}
+
+/**
+ * Whether `hist` is better checked by this search than by the engine of its
+ * type, whose bound in the README is O(n^degree * 2^(degree * k)), unless
+ * `chosen` decides.
+ *
+ * That bound holds whatever the verdict, whereas this search is fast when
+ * values fix the order of operations, and exponential in the processes whose
+ * operations may take effect in many orders otherwise, notably when no
+ * linearization exists. So it is only preferred when the other bound, with the
+ * mean concurrency at responses rather than the maximal one, exceeds `BUDGET`,
+ * and its own worst case, in the concurrency of repeated values, is less.
+ */
+template <typename value_type>
+bool preferred(const history_t<value_type>& hist, const monitor_context& ctx,
+               int degree) {
+  if (std::optional<bool> choice = chosen(hist, ctx)) return *choice;
+
+  // responses before calls at the same time, as `get_events` sorts them
+  std::vector<std::pair<time_type, bool>> events;
+  events.reserve(2 * hist.size());
+  for (const operation_t<value_type>& o : hist) {
+    events.emplace_back(o.startTime, true);
+    events.emplace_back(o.endTime, false);
+  }
+  std::sort(events.begin(), events.end());
+
+  std::size_t pending = 0, max_pending = 0, sum_pending = 0;
+  for (auto [time, is_inv] : events) {
+    if (is_inv) {
+      max_pending = std::max(max_pending, ++pending);
+    } else {
+      sum_pending += pending--;
+    }
+  }
+
+  double n = std::log2(double(hist.size()));
+  double k = double(sum_pending) / hist.size();
+  // in practice, one factor of n fewer for the engines of degree above 1
+  double fpt = std::max(degree - 1, 1) * n + degree * k;
+  if (fpt <= BUDGET) return false;
+
+  std::vector<value_type> values;
+  values.reserve(hist.size());
+  for (const operation_t<value_type>& o : hist) values.push_back(o.value);
+  std::sort(values.begin(), values.end());
+  double distinct =
+      double(std::unique(values.begin(), values.end()) - values.begin()) /
+      hist.size();
+  double jit = n + max_pending * (1 - distinct);
+  return jit < fpt;
+}
+
+}  // namespace jit
+
+}  // namespace fptlin
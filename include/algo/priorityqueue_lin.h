@@ -2,8 +2,11 @@
 
 #include <queue>
 #include <unordered_map>
+#include <vector>
 
-#include "aadt_lin.h"
+#include "greedy_lin.h"
+#include "jit_lin.h"
+#include "monitor_context.h"
 
 namespace fptlin {
 
@@ -51,7 +54,38 @@ struct priority_queue_impl {
     }
   }
 
+  // both inserting, both only reading, or alike
+  static bool independent(const operation_t<value_type>* o1,
+                          const operation_t<value_type>* o2) {
+    return (o1->method == INSERT && o2->method == INSERT) ||
+           (reads(o1) && reads(o2)) ||
+           (o1->method == o2->method && o1->value == o2->value);
+  }
+
+  // the values held, without those pending removal
+  void save(checkpoint_writer& w) const {
+    priority_queue_impl copy = *this;
+    std::vector<value_type> values;
+    for (copy.cleanup(); !copy.heap.empty(); copy.cleanup()) {
+      values.push_back(copy.heap.top());
+      copy.heap.pop();
+    }
+    w.put(values.size());
+    for (const value_type& v : values) w.put(v);
+  }
+
+  void load(checkpoint_reader& r) {
+    *this = {};
+    for (std::size_t n = r.get<std::size_t>(); n; --n)
+      heap.push(r.get<value_type>());
+  }
+
  private:
+  static bool reads(const operation_t<value_type>* o) {
+    return o->method == PEEK ||
+           (o->method == POLL && o->value == EMPTY_VALUE);
+  }
+
   std::priority_queue<value_type> heap;
   std::unordered_map<value_type, std::size_t> removed_count;
 
@@ -67,9 +101,30 @@ struct priority_queue_impl {
 };
 
 template <typename value_type>
-bool is_linearizable(history_t<value_type>& hist) {
-  return aadt::impl<value_type, priority_queue_impl<value_type>>()
-      .is_linearizable(hist);
+using model_t = priority_queue_impl<value_type>;
+
+// from the state `model`, which is left in the state after `hist` if
+// linearizable
+template <typename value_type>
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx,
+                     model_t<value_type>& model) {
+  if (greedy::is_linearizable(hist, ctx, model)) {
+    ctx.engine = Engine::GREEDY;
+    return true;
+  }
+  if (jit::preferred(hist, ctx, 1))
+    return jit::is_linearizable(hist, ctx, model);
+  ctx.engine = Engine::AADT;
+  aadt::impl<value_type, model_t<value_type>> search(model, ctx.memory);
+  if (!search.is_linearizable(hist, ctx)) return false;
+  model = search.model();
+  return true;
+}
+
+template <typename value_type>
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+  model_t<value_type> model;
+  return is_linearizable(hist, ctx, model);
 }
 
 }  // namespace priorityqueue
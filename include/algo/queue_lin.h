@@ -1,51 +1,142 @@
 #pragma once
 
+#include <algorithm>
+#include <deque>
+#include <memory_resource>
 #include <optional>
 #include <queue>
+#include <utility>
+#include <vector>
 
+#include "arena.h"
 #include "frontier_graph.h"
+#include "greedy_lin.h"
+#include "jit_lin.h"
+#include "monitor_context.h"
 
 namespace fptlin {
 
 namespace queue {
 
+// Sequential queue. Its state depends on the order operations are applied in,
+// so it is only meant for engines that track the order, e.g. `greedy`.
+template <typename value_type>
+struct queue_impl {
+  bool apply(operation_t<value_type>* o) {
+    switch (o->method) {
+      case ENQ:
+        q.push_back(o->value);
+        return true;
+      case DEQ:
+        if (o->value == EMPTY_VALUE) return q.empty();
+        if (q.empty() || q.front() != o->value) return false;
+        q.pop_front();
+        return true;
+      case PEEK:
+        if (o->value == EMPTY_VALUE) return q.empty();
+        return !q.empty() && q.front() == o->value;
+      default:
+        std::unreachable();
+    }
+  }
+
+  void undo(operation_t<value_type>* o) {
+    switch (o->method) {
+      case ENQ:
+        q.pop_back();
+        return;
+      case DEQ:
+        if (o->value != EMPTY_VALUE) q.push_front(o->value);
+        return;
+      default:
+        return;
+    }
+  }
+
+  const std::deque<value_type>& state() const { return q; }
+
+ private:
+  std::deque<value_type> q;
+};
+
 template <typename value_type>
 struct impl {
   using non_terminal = value_type;
-  using dym_matrix = std::unordered_map<
-      node, std::unordered_map<node, non_terminal, node_hash>, node_hash>;
+  using dym_matrix = std::pmr::unordered_map<
+      node, std::pmr::unordered_map<node, non_terminal, node_hash>,
+      node_hash>;
 
  public:
-  bool is_linearizable(history_t<value_type>& hist) {
+  // `memory` as `monitor_context::memory` of the checks
+  explicit impl(
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : enq_graph(memory), front_graph(memory), matrix(memory) {}
+
+  bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
     if (hist.empty()) return true;
+    require_proc_bits(hist);
 
-    events_t<value_type> events = get_events(hist);
-    std::sort(events.begin(), events.end());
-    enq_graph.build(events);
-    front_graph.build(events);
+    events_t<value_type> events;
+    {
+      scoped_phase phase(ctx.stats, Phase::SORT);
+      events = get_events(hist);
+      std::sort(events.begin(), events.end());
+    }
+    ctx.progress.layers = events.size();
+    {
+      scoped_phase phase(ctx.stats, Phase::GRAPH_BUILD);
+      enq_graph.build(events, ctx);
+      front_graph.build(events, ctx);
+    }
+
+    // the graphs grow with the search
+    scoped_phase phase(ctx.stats, Phase::SEARCH);
+    arena_held<node_set> vis(ctx.memory);
+    // also of searches that run out of budget
+    auto count = [&] {
+      ctx.stats.add(Counter::GRAPH_NODES,
+                    enq_graph.size() + front_graph.size());
+      ctx.stats.add(Counter::NODES_VISITED, vis->size());
+      if constexpr (monitor_stats::enabled)
+        for (auto& [a, row] : *matrix)
+          ctx.stats.add(Counter::MATRIX_CELLS, row.size());
+    };
+    bool res;
+    try {
+      res = search(events.size(), *vis, ctx);
+    } catch (const budget_exhausted&) {
+      count();
+      throw;
+    }
+    count();
+    return res;
+  }
 
-    node_set vis;
+ private:
+  bool search(std::size_t events_size, node_set& vis, monitor_context& ctx) {
     node source{0, 0U};
-    dest = front_graph.first_same_node({static_cast<int>(events.size()), 0U});
+    dest = front_graph.first_same_node({static_cast<int>(events_size), 0U});
     bfs.push(source);
-    matrix[source][source] = EMPTY_VALUE;
+    (*matrix)[source][source] = EMPTY_VALUE;
     while (!bfs.empty()) {
       node v = bfs.front();
       bfs.pop();
-      if (vis.insert(v).second && extend_node(v)) return true;
+      if (!vis.insert(v).second) continue;
+      ctx.step();
+      ctx.reach(v.layer);
+      if (extend_node(v, ctx)) return true;
     }
     return false;
   }
 
- private:
   // Returns `true` if `dest` is found/reached
-  bool extend_node(node a) {
-    return extend_front(a) || extend_empty(a) || extend_enq(a);
+  bool extend_node(node a, monitor_context& ctx) {
+    return extend_front(a, ctx) || extend_empty(a, ctx) || extend_enq(a);
   }
 
-  bool extend_front(node a) {
+  bool extend_front(node a, monitor_context& ctx) {
     std::queue<node> next_b;
-    for (auto& [b, entry] : matrix[a])
+    for (auto& [b, entry] : (*matrix)[a])
       if (entry != EMPTY_VALUE) next_b.push(b);
 
     node_set local_vis;
@@ -53,11 +144,12 @@ struct impl {
       node b = next_b.front();
       next_b.pop();
       if (!local_vis.insert(b).second) continue;
+      ctx.step();
 
       for (auto [c, optr] : front_graph.next(b)) {
-        if (optr->value == matrix[a][b]) {
+        if (optr->value == (*matrix)[a][b]) {
           if (c == dest) return true;
-          matrix[a][c] =
+          (*matrix)[a][c] =
               optr->method == Method::PEEK ? optr->value : EMPTY_VALUE;
           if (optr->method == Method::PEEK) next_b.push(c);
         }
@@ -66,9 +158,9 @@ struct impl {
     return false;
   }
 
-  bool extend_empty(node a) {
+  bool extend_empty(node a, monitor_context& ctx) {
     std::queue<node> next_b;
-    for (auto& [b, entry] : matrix[a])
+    for (auto& [b, entry] : (*matrix)[a])
       if (entry == EMPTY_VALUE) next_b.push(b);
 
     node_set local_vis;
@@ -76,12 +168,13 @@ struct impl {
       node b = next_b.front();
       next_b.pop();
       if (!local_vis.insert(b).second) continue;
+      ctx.step();
 
       for (auto [c, optr] : front_graph.next(b)) {
         if (optr->value == EMPTY_VALUE && overlaps(a, c)) {
           if (c == dest) return true;
           next_b.push(c);
-          matrix[a][c] = EMPTY_VALUE;
+          (*matrix)[a][c] = EMPTY_VALUE;
         }
       }
     }
@@ -89,13 +182,13 @@ struct impl {
   }
 
   bool extend_enq(node a) {
-    for (auto& [b, entry] : matrix[a])
+    for (auto& [b, entry] : (*matrix)[a])
       if (entry == EMPTY_VALUE)  // extend only when previous tracked
                                  // value is dequeued
         for (auto [c, optr] : enq_graph.next(a)) {
           if (!precedes(b, c)) {
             bfs.push(c);
-            matrix[c][b] = optr->value;
+            (*matrix)[c][b] = optr->value;
           }
         }
     return false;
@@ -115,15 +208,158 @@ struct impl {
   }
 
   node dest;
-  frontier_graph<value_type, Method::ENQ> enq_graph;
-  frontier_graph<value_type, Method::PEEK, Method::DEQ> front_graph;
-  dym_matrix matrix;
+  lazy_frontier_graph<value_type, Method::ENQ> enq_graph;
+  lazy_frontier_graph<value_type, Method::PEEK, Method::DEQ> front_graph;
+  arena_held<dym_matrix> matrix;
   std::queue<node> bfs;
 };
 
+/**
+ * Engine for histories in which every value is enqueued at most once.
+ *
+ * Without peeks and empty dequeues, such a history is linearizable iff no
+ * value is dequeued before it is enqueued or more than once, and there are no
+ * `a`, `b` with ENQ(a) preceding ENQ(b) while DEQ(b) exists and DEQ(a) is
+ * either missing or preceded by DEQ(b) (Henzinger et al., CONCUR'13).
+ * All checks run in O(n log n) and are oblivious to the number of processes.
+ *
+ * An empty dequeue, or an empty peek, which no more changes the queue, must
+ * take effect while the queue is empty. A value is in the queue from the
+ * response of its enqueue to the call of its dequeue, if any, whatever the
+ * linearization, so an empty dequeue whose interval these spans cover together
+ * refutes the history; otherwise it is linearizable (Bouajjani et al.,
+ * ICALP'15).
+ *
+ * Peeks of values do not change the queue either, so a violation among the
+ * other operations still refutes the history, as does a peek of a value not
+ * enqueued before it or dequeued before it, but their absence does not prove
+ * it linearizable. Such results are left undecided, to the frontier engine, or
+ * to the `JIT` engine for more processes than that takes, whose cost grows
+ * with the operations pending at once.
+ */
+template <typename value_type>
+struct distinct_impl {
+  using op_ptr = operation_t<value_type>*;
+
+ public:
+  // `std::nullopt` when undecided
+  std::optional<bool> is_linearizable(history_t<value_type>& hist,
+                                      monitor_context& ctx) {
+    scoped_phase phase(ctx.stats, Phase::DISTINCT);
+    std::unordered_map<value_type, std::pair<op_ptr, op_ptr>> ops;
+    std::vector<op_ptr> peeks, empties;
+    for (auto& o : hist) {
+      if (o.method != Method::ENQ && o.value == EMPTY_VALUE) {
+        empties.push_back(&o);
+        continue;
+      }
+      if (o.method == Method::PEEK) {
+        peeks.push_back(&o);
+        continue;
+      }
+      auto& [enq, deq] = ops[o.value];
+      if (o.method == Method::ENQ) {
+        enq = &o;
+        continue;
+      }
+      // repeated dequeue
+      if (deq) return false;
+      deq = &o;
+    }
+
+    std::vector<std::pair<op_ptr, op_ptr>> by_enq_end, by_enq_start;
+    for (auto& [value, pair] : ops) {
+      auto [enq, deq] = pair;
+      // dequeue without (preceding) enqueue
+      if (!enq || (deq && precedes(deq, enq))) return false;
+      by_enq_end.push_back(pair);
+      if (deq) by_enq_start.push_back(pair);
+    }
+    std::sort(by_enq_end.begin(), by_enq_end.end(), [](auto& a, auto& b) {
+      return a.first->endTime < b.first->endTime;
+    });
+    std::sort(by_enq_start.begin(), by_enq_start.end(), [](auto& a, auto& b) {
+      return a.first->startTime < b.first->startTime;
+    });
+
+    // sweep over `b` by ENQ(b) start, keeping the latest DEQ(a) start over all
+    // `a` with ENQ(a) preceding ENQ(b); a missing DEQ(a) counts as infinity
+    time_type latest_deq = 0;
+    std::size_t i = 0;
+    for (auto [enq_b, deq_b] : by_enq_start) {
+      for (; i < by_enq_end.size() &&
+             precedes(by_enq_end[i].first, enq_b);
+           ++i) {
+        op_ptr deq_a = by_enq_end[i].second;
+        latest_deq = std::max(latest_deq, deq_a ? deq_a->startTime : MAX_TIME);
+      }
+      if (i && deq_b->endTime <= latest_deq) return false;
+    }
+
+    if (!empties.empty() && covered(by_enq_end, empties)) return false;
+    for (op_ptr peek : peeks) {
+      auto it = ops.find(peek->value);
+      if (it == ops.end()) return false;
+      auto [enq, deq] = it->second;
+      if (precedes(peek, enq) || (deq && precedes(deq, peek))) return false;
+    }
+    if (!peeks.empty()) return std::nullopt;
+    return true;
+  }
+
+ private:
+  // whether some of `empties` spans no instant at which the queue may be
+  // empty, with `pairs` the enqueues and dequeues of each value
+  static bool covered(const std::vector<std::pair<op_ptr, op_ptr>>& pairs,
+                      const std::vector<op_ptr>& empties) {
+    // the open spans in which a value is in the queue, merged where they
+    // overlap
+    std::vector<std::pair<instant, instant>> held;
+    for (auto [enq, deq] : pairs) {
+      instant from{enq->endTime, false};
+      instant to =
+          deq ? instant{deq->startTime, true} : instant{MAX_TIME, true};
+      if (from < to) held.emplace_back(from, to);
+    }
+    std::sort(held.begin(), held.end());
+    std::vector<std::pair<instant, instant>> merged;
+    for (auto& span : held) {
+      if (!merged.empty() && span.first < merged.back().second)
+        merged.back().second = std::max(merged.back().second, span.second);
+      else
+        merged.push_back(span);
+    }
+
+    for (op_ptr o : empties) {
+      instant start{o->startTime, true}, end{o->endTime, false};
+      auto it = std::upper_bound(
+          merged.begin(), merged.end(), start,
+          [](const instant& t, const auto& span) { return t < span.first; });
+      if (it != merged.begin() && end <= std::prev(it)->second) return true;
+    }
+    return false;
+  }
+};
+
 template <typename value_type>
-bool is_linearizable(history_t<value_type>& hist) {
-  return impl<value_type>().is_linearizable(hist);
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+  if (greedy::is_linearizable<value_type, queue_impl<value_type>>(hist, ctx)) {
+    ctx.engine = Engine::GREEDY;
+    return true;
+  }
+  if (distinct_values<Method::ENQ>(hist)) {
+    ctx.engine = Engine::DISTINCT_QUEUE;
+    std::optional<bool> res =
+        distinct_impl<value_type>().is_linearizable(hist, ctx);
+    if (res) return *res;
+  }
+  // the engine below, whose graphs are built lazily and skip alike
+  // operations, decides what this search would in far less time and memory,
+  // unless it cannot
+  if (jit::chosen(hist, ctx).value_or(false))
+    return jit::is_linearizable<value_type, queue_impl<value_type>>(hist, ctx);
+  ctx.engine = Engine::FRONTIER_QUEUE;
+  return impl<value_type>(ctx.memory).is_linearizable(hist, ctx);
 }
 
 }  // namespace queue
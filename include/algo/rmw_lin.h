@@ -1,6 +1,8 @@
 #pragma once
 
-#include "aadt_lin.h"
+#include "greedy_lin.h"
+#include "jit_lin.h"
+#include "monitor_context.h"
 
 namespace fptlin {
 
@@ -24,14 +26,47 @@ struct rmw_impl {
     reg = a;
   }
 
+  // neither may follow the other, or both only read
+  static bool independent(const operation_t<pair_value_t>* o1,
+                          const operation_t<pair_value_t>* o2) {
+    auto [a1, b1] = o1->value;
+    auto [a2, b2] = o2->value;
+    return (b1 != a2 && b2 != a1) || (a1 == b1 && a2 == b2);
+  }
+
+  void save(checkpoint_writer& w) const { w.put(reg); }
+
+  void load(checkpoint_reader& r) { reg = r.get<value_type>(); }
+
  private:
   value_type reg;
 };
 
 template <typename pair_value_t>
-bool is_linearizable(history_t<pair_value_t>& hist) {
-  return aadt::impl<pair_value_t, rmw_impl<pair_value_t>>().is_linearizable(
-      hist);
+using model_t = rmw_impl<pair_value_t>;
+
+// from the state `model`, which is left in the state after `hist` if
+// linearizable
+template <typename pair_value_t>
+bool is_linearizable(history_t<pair_value_t>& hist, monitor_context& ctx,
+                     model_t<pair_value_t>& model) {
+  if (greedy::is_linearizable(hist, ctx, model)) {
+    ctx.engine = Engine::GREEDY;
+    return true;
+  }
+  if (jit::preferred(hist, ctx, 1))
+    return jit::is_linearizable(hist, ctx, model);
+  ctx.engine = Engine::AADT;
+  aadt::impl<pair_value_t, model_t<pair_value_t>> search(model, ctx.memory);
+  if (!search.is_linearizable(hist, ctx)) return false;
+  model = search.model();
+  return true;
+}
+
+template <typename pair_value_t>
+bool is_linearizable(history_t<pair_value_t>& hist, monitor_context& ctx) {
+  model_t<pair_value_t> model;
+  return is_linearizable(hist, ctx, model);
 }
 
 }  // namespace rmw
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <ranges>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "fptlinutils.h"
+#include "greedy_lin.h"
+#include "jit_lin.h"
+#include "monitor_context.h"
+
+namespace fptlin {
+
+namespace rw_register {
+
+template <typename value_type>
+struct rw_register_impl {
+  bool apply(operation_t<value_type>* o) {
+    switch (o->method) {
+      case READ:
+        return o->value == reg;
+      case WRITE:
+        overwritten.push_back(reg);
+        reg = o->value;
+        return true;
+      default:
+        std::unreachable();
+    }
+  }
+
+  void undo(operation_t<value_type>* o) {
+    if (o->method != WRITE) return;
+    reg = overwritten.back();
+    overwritten.pop_back();
+  }
+
+  // the value depends on the order writes are applied in
+  std::ranges::single_view<value_type> state() const {
+    return std::views::single(reg);
+  }
+
+ private:
+  value_type reg{};
+
+  // by the writes applied, in order, for `undo`
+  std::vector<value_type> overwritten;
+};
+
+/**
+ * Engine for histories in which every value is written at most once, and
+ * never the initial one.
+ *
+ * The write of a value and the reads returning it form a cluster, whose zone
+ * spans from the first response to the last invocation among them: forward if
+ * the response comes first, so that the value must be held in between, and
+ * backward otherwise. Such a history is linearizable iff no read returns a
+ * value never written, or responds before its write is invoked, no two forward
+ * zones overlap, and no backward zone lies within a forward one (Gibbons &
+ * Korach, SIAM J. Comput. 1997). The initial value is written before any
+ * operation. All checks run in O(n log n) and are oblivious to the number of
+ * processes.
+ */
+template <typename value_type>
+struct distinct_impl {
+  using op_ptr = operation_t<value_type>*;
+
+ public:
+  // `std::nullopt` when undecided
+  std::optional<bool> is_linearizable(history_t<value_type>& hist,
+                                      monitor_context& ctx) {
+    scoped_phase phase(ctx.stats, Phase::DISTINCT);
+    struct cluster {
+      op_ptr write = nullptr;
+      instant first_read_end{MAX_TIME, false};
+      instant zone_end{MAX_TIME, false}, zone_start{MIN_TIME, true};
+    };
+    std::unordered_map<value_type, cluster> clusters;
+    for (auto& o : hist) {
+      instant end{o.endTime, false}, start{o.startTime, true};
+      cluster& c = clusters[o.value];
+      if (o.method == Method::WRITE) {
+        // written as well as held initially
+        if (o.value == value_type{}) return std::nullopt;
+        c.write = &o;
+      } else {
+        c.first_read_end = std::min(c.first_read_end, end);
+      }
+      c.zone_end = std::min(c.zone_end, end);
+      c.zone_start = std::max(c.zone_start, start);
+    }
+
+    // the zones, each as its ends in order
+    std::vector<std::pair<instant, instant>> forward, backward;
+    for (auto& [value, c] : clusters) {
+      if (value == value_type{}) {
+        c.zone_end = {MIN_TIME, false};
+      } else if (!c.write ||
+                 c.first_read_end < instant{c.write->startTime, true}) {
+        // read without (preceding) write
+        return false;
+      }
+      if (c.zone_end < c.zone_start)
+        forward.emplace_back(c.zone_end, c.zone_start);
+      else
+        backward.emplace_back(c.zone_start, c.zone_end);
+    }
+
+    std::sort(forward.begin(), forward.end());
+    for (std::size_t i = 1; i < forward.size(); ++i)
+      if (forward[i].first < forward[i - 1].second) return false;
+
+    // only the last forward zone starting before a backward one may hold it
+    for (auto [start, end] : backward) {
+      auto it = std::lower_bound(
+          forward.begin(), forward.end(), start,
+          [](const auto& zone, const instant& t) { return zone.first < t; });
+      if (it != forward.begin() && end < std::prev(it)->second) return false;
+    }
+    return true;
+  }
+};
+
+template <typename value_type>
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+  if (greedy::is_linearizable<value_type, rw_register_impl<value_type>>(hist,
+                                                                      ctx)) {
+    ctx.engine = Engine::GREEDY;
+    return true;
+  }
+  if (distinct_values<Method::WRITE>(hist)) {
+    ctx.engine = Engine::DISTINCT_REGISTER;
+    std::optional<bool> res =
+        distinct_impl<value_type>().is_linearizable(hist, ctx);
+    if (res) return *res;
+  }
+  // the state of a register depends on the order of writes, which the nodes
+  // of the aadt search do not tell apart
+  return jit::is_linearizable<value_type, rw_register_impl<value_type>>(hist,
+                                                                        ctx);
+}
+
+}  // namespace rw_register
+
+}  // namespace fptlin
@@ -2,7 +2,9 @@
 
 #include <utility>
 
-#include "aadt_lin.h"
+#include "greedy_lin.h"
+#include "jit_lin.h"
+#include "monitor_context.h"
 
 namespace fptlin {
 
@@ -34,13 +36,45 @@ struct semaphore_impl {
       ++cnt;
   }
 
+  // both only checking that none is held, or alike
+  static bool independent(const operation_t<bool>* o1,
+                          const operation_t<bool>* o2) {
+    return (!o1->value && !o2->value) ||
+           (o1->method == o2->method && o1->value == o2->value);
+  }
+
+  void save(checkpoint_writer& w) const { w.put(cnt); }
+
+  void load(checkpoint_reader& r) { cnt = r.get<uint32_t>(); }
+
  private:
-  uint32_t cnt;
+  uint32_t cnt = 0;
 };
 
 // `value_t` is expected to be bool
-bool is_linearizable(history_t<bool>& hist) {
-  return aadt::impl<bool, semaphore_impl>().is_linearizable(hist);
+template <typename value_t>
+using model_t = semaphore_impl;
+
+// from the state `model`, which is left in the state after `hist` if
+// linearizable
+inline bool is_linearizable(history_t<bool>& hist, monitor_context& ctx,
+                            semaphore_impl& model) {
+  if (greedy::is_linearizable(hist, ctx, model)) {
+    ctx.engine = Engine::GREEDY;
+    return true;
+  }
+  if (jit::preferred(hist, ctx, 1))
+    return jit::is_linearizable(hist, ctx, model);
+  ctx.engine = Engine::AADT;
+  aadt::impl<bool, semaphore_impl> search(model, ctx.memory);
+  if (!search.is_linearizable(hist, ctx)) return false;
+  model = search.model();
+  return true;
+}
+
+inline bool is_linearizable(history_t<bool>& hist, monitor_context& ctx) {
+  semaphore_impl model;
+  return is_linearizable(hist, ctx, model);
 }
 
 }  // namespace semaphore
@@ -2,7 +2,9 @@
 
 #include <unordered_set>
 
-#include "aadt_lin.h"
+#include "greedy_lin.h"
+#include "jit_lin.h"
+#include "monitor_context.h"
 
 namespace fptlin {
 
@@ -12,8 +14,6 @@ template <typename pair_value_t>
 struct set_impl {
   using value_type = std::tuple_element<0, pair_value_t>::type;
 
-  set_impl() : reg{0} {}
-
   bool apply(operation_t<pair_value_t>* o) {
     auto [a, b] = o->value;
     switch (o->method) {
@@ -46,14 +46,58 @@ struct set_impl {
     }
   }
 
+  // on different values, both only reading, or alike
+  static bool independent(const operation_t<pair_value_t>* o1,
+                          const operation_t<pair_value_t>* o2) {
+    if (std::get<0>(o1->value) != std::get<0>(o2->value)) return true;
+    return (reads(o1) && reads(o2)) ||
+           (o1->method == o2->method && o1->value == o2->value);
+  }
+
+  void save(checkpoint_writer& w) const {
+    w.put(reg.size());
+    for (const value_type& a : reg) w.put(a);
+  }
+
+  void load(checkpoint_reader& r) {
+    reg.clear();
+    for (std::size_t n = r.get<std::size_t>(); n; --n)
+      reg.insert(r.get<value_type>());
+  }
+
  private:
+  static bool reads(const operation_t<pair_value_t>* o) {
+    return o->method == CONTAINS || !std::get<1>(o->value);
+  }
+
   std::unordered_set<value_type> reg;
 };
 
 template <typename pair_value_t>
-bool is_linearizable(history_t<pair_value_t>& hist) {
-  return aadt::impl<pair_value_t, set_impl<pair_value_t>>().is_linearizable(
-      hist);
+using model_t = set_impl<pair_value_t>;
+
+// from the state `model`, which is left in the state after `hist` if
+// linearizable
+template <typename pair_value_t>
+bool is_linearizable(history_t<pair_value_t>& hist, monitor_context& ctx,
+                     model_t<pair_value_t>& model) {
+  if (greedy::is_linearizable(hist, ctx, model)) {
+    ctx.engine = Engine::GREEDY;
+    return true;
+  }
+  if (jit::preferred(hist, ctx, 1))
+    return jit::is_linearizable(hist, ctx, model);
+  ctx.engine = Engine::AADT;
+  aadt::impl<pair_value_t, model_t<pair_value_t>> search(model, ctx.memory);
+  if (!search.is_linearizable(hist, ctx)) return false;
+  model = search.model();
+  return true;
+}
+
+template <typename pair_value_t>
+bool is_linearizable(history_t<pair_value_t>& hist, monitor_context& ctx) {
+  model_t<pair_value_t> model;
+  return is_linearizable(hist, ctx, model);
 }
 
 }  // namespace set
@@ -1,11 +1,61 @@
 #pragma once
 
+#include <set>
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+
+#include "fptlinutils.h"
+#include "greedy_lin.h"
+#include "jit_lin.h"
+#include "monitor_context.h"
 #include "unamb_cfg_lin.h"
 
 namespace fptlin {
 
 namespace stack {
 
+// Sequential stack. Its state depends on the order operations are applied in,
+// so it is only meant for engines that track the order, e.g. `greedy`.
+template <typename value_type>
+struct stack_impl {
+  bool apply(operation_t<value_type>* o) {
+    switch (o->method) {
+      case PUSH:
+        st.push_back(o->value);
+        return true;
+      case POP:
+        if (o->value == EMPTY_VALUE) return st.empty();
+        if (st.empty() || st.back() != o->value) return false;
+        st.pop_back();
+        return true;
+      case PEEK:
+        if (o->value == EMPTY_VALUE) return st.empty();
+        return !st.empty() && st.back() == o->value;
+      default:
+        std::unreachable();
+    }
+  }
+
+  void undo(operation_t<value_type>* o) {
+    switch (o->method) {
+      case PUSH:
+        st.pop_back();
+        return;
+      case POP:
+        if (o->value != EMPTY_VALUE) st.push_back(o->value);
+        return;
+      default:
+        return;
+    }
+  }
+
+  const std::vector<value_type>& state() const { return st; }
+
+ private:
+  std::vector<value_type> st;
+};
+
 template <typename value_type>
 struct stack_grammar {
   enum NonTerminalSymbol {
@@ -47,6 +97,23 @@ struct stack_grammar {
 
     return std::nullopt;
   }
+
+  // pops less pushes of each value, hashed, which is 0 for T and that of a
+  // single pop of v for T_v
+  static uint64_t weight(operation_t<value_type>* optr) {
+    uint64_t h = static_cast<uint64_t>(optr->value) + 0x9e3779b97f4a7c15;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+    h ^= h >> 31;
+    switch (optr->method) {
+      case Method::PUSH:
+        return -h;
+      case Method::POP:
+        return h;
+      default:
+        return 0;
+    }
+  }
 };
 
 // prepend an operation that pushes the empty value
@@ -80,12 +147,429 @@ void make_match(history_t<value_type>& hist) {
   }
 }
 
+/**
+ * Engine for histories in which every value is pushed at most once.
+ *
+ * A history is refuted, in O(n log n), if it contains any of the following:
+ *  - a value popped or peeked without a preceding push, or popped twice;
+ *  - a value peeked after it was popped;
+ *  - PUSH(a) preceding PUSH(b) preceding a POP/PEEK of `a`, while POP(b) is
+ *    missing or follows it, so that `b` is always above `a` there;
+ *  - PUSH(v) preceding an empty POP/PEEK, while POP(v) is missing or follows
+ *    it.
+ * Values whose operations can all take effect at a common instant are dropped
+ * beforehand, as they fit into any linearization of the rest. The remainder is
+ * simulated on a stack, placing operations only once they are minimal w.r.t.
+ * real-time order. Observations of the top value and of the empty stack are
+ * placed as early as possible, which never loses a linearization. Among
+ * pushes, those whose observers are all placeable go first; otherwise one
+ * simulation prefers the push that leaves the most room for the others to be
+ * popped above it, and another the most urgent push. A complete simulation
+ * proves the history linearizable, O(n log n).
+ *
+ * Histories that are neither refuted nor simulated are left undecided, with
+ * the dropped values removed from `hist`.
+ */
 template <typename value_type>
-bool is_linearizable(history_t<value_type>& hist) {
+struct distinct_impl {
+  using op_ptr = operation_t<value_type>*;
+
+  // number of pushes weighed against each other when none is ready
+  static constexpr std::size_t WINDOW = greedy::WINDOW;
+
+ public:
+  // `std::nullopt` when undecided
+  std::optional<bool> is_linearizable(history_t<value_type>& hist,
+                                      monitor_context& ctx) {
+    scoped_phase phase(ctx.stats, Phase::DISTINCT);
+    if (!collect(hist)) return false;
+    if (reduce(hist)) {
+      values.clear();
+      empties.clear();
+      collect(hist);
+    }
+    if (refuted()) return false;
+    if (simulate(hist, false) || simulate(hist, true)) return true;
+    return std::nullopt;
+  }
+
+ private:
+  struct value_ops {
+    op_ptr push = nullptr;
+    op_ptr pop = nullptr;
+    std::vector<op_ptr> peeks;  // sorted by end time
+    time_type last_peek = 0;    // latest peek start
+    time_type pushed_by = 0;    // the push is placed before this time
+
+    // simulation states
+    std::size_t unavailable = 0;  // pop and peeks not yet minimal
+    std::size_t next_peek = 0;    // first unplaced in `peeks`
+    std::vector<op_ptr> available_peeks;
+  };
+
+  static bool is_empty_op(op_ptr o) {
+    return o->method != Method::PUSH && o->value == EMPTY_VALUE;
+  }
+
+  // latest possible pop, as a start time
+  time_type key(const value_ops& v) const {
+    return v.pop ? v.pop->startTime : MAX_TIME;
+  }
+
+  // bottom-first order: popped last, then done being peeked first
+  using push_order = std::tuple<time_type, time_type, op_ptr>;
+  push_order order(const value_ops& v) const {
+    return {key(v), MAX_TIME - v.last_peek, v.push};
+  }
+
+  using slack_type = std::make_signed_t<time_type>;
+
+  // latest start of an observer of `v`, if popped
+  static time_type last_start(const value_ops& v) {
+    return std::max(v.pop->startTime, v.last_peek);
+  }
+
+  // room left for `y` to stay below `x`, i.e. for every observer of `x` to
+  // precede the observers of `y` that cannot precede PUSH(x); positive if
+  // possible
+  static slack_type slack(const value_ops& y, const value_ops& x) {
+    time_type deadline = MAX_TIME;
+    if (y.pop && x.pushed_by <= y.pop->startTime) deadline = y.pop->endTime;
+    for (op_ptr peek : y.peeks)
+      if (x.pushed_by <= peek->startTime)
+        deadline = std::min(deadline, peek->endTime);
+    if (deadline == MAX_TIME) return std::numeric_limits<slack_type>::max();
+    if (!x.pop) return 0;
+    return slack_type(deadline) - slack_type(last_start(x));
+  }
+
+  static bool can_stay_below(const value_ops& y, const value_ops& x) {
+    return slack(y, x) > 0;
+  }
+
+  bool collect(history_t<value_type>& hist) {
+    for (auto& o : hist) {
+      if (is_empty_op(&o)) {
+        empties.push_back(&o);
+        continue;
+      }
+      value_ops& v = values[o.value];
+      switch (o.method) {
+        case Method::PUSH:
+          v.push = &o;
+          break;
+        case Method::POP:
+          if (v.pop) return false;
+          v.pop = &o;
+          break;
+        case Method::PEEK:
+          v.peeks.push_back(&o);
+          break;
+        default:
+          std::unreachable();
+      }
+    }
+
+    for (auto& [value, v] : values) {
+      if (!v.push || (v.pop && precedes(v.pop, v.push))) return false;
+      for (op_ptr peek : v.peeks) {
+        if (precedes(peek, v.push) || (v.pop && precedes(v.pop, peek)))
+          return false;
+        v.last_peek = std::max(v.last_peek, peek->startTime);
+      }
+      std::sort(v.peeks.begin(), v.peeks.end(),
+                [](op_ptr a, op_ptr b) { return a->endTime < b->endTime; });
+      v.pushed_by = v.push->endTime;
+      if (v.pop) v.pushed_by = std::min(v.pushed_by, v.pop->endTime);
+      if (!v.peeks.empty())
+        v.pushed_by = std::min(v.pushed_by, v.peeks.front()->endTime);
+    }
+    return true;
+  }
+
+  // drops values whose operations can all take effect at a common instant;
+  // such a value can be linearized back as a contiguous PUSH, PEEK.., POP at
+  // that instant into any linearization of the rest
+  bool reduce(history_t<value_type>& hist) {
+    std::unordered_set<value_type> removed;
+    for (auto& [value, v] : values) {
+      if (!v.pop) continue;
+      time_type first_end = v.pushed_by, last_start = v.pop->startTime;
+      last_start = std::max({last_start, v.push->startTime, v.last_peek});
+      if (last_start < first_end) removed.insert(value);
+    }
+    if (removed.empty()) return false;
+    std::erase_if(hist, [&](auto& o) {
+      return !is_empty_op(&o) && removed.contains(o.value);
+    });
+    return true;
+  }
+
+  bool refuted() {
+    std::vector<const value_ops*> by_push_end, by_push_start;
+    for (auto& [value, v] : values) by_push_end.push_back(&v);
+    by_push_start = by_push_end;
+    std::sort(by_push_end.begin(), by_push_end.end(), [](auto a, auto b) {
+      return a->push->endTime < b->push->endTime;
+    });
+    std::sort(by_push_start.begin(), by_push_start.end(), [](auto a, auto b) {
+      return a->push->startTime < b->push->startTime;
+    });
+
+    // values certainly on the stack during an empty observation
+    std::sort(empties.begin(), empties.end(),
+              [](op_ptr a, op_ptr b) { return a->startTime < b->startTime; });
+    time_type latest_pop = 0;
+    std::size_t i = 0;
+    for (op_ptr e : empties) {
+      for (; i < by_push_end.size() && precedes(by_push_end[i]->push, e); ++i)
+        latest_pop = std::max(latest_pop, key(*by_push_end[i]));
+      if (i && latest_pop >= e->endTime) return true;
+    }
+
+    // values certainly above `a` while it is observed on top; pushes preceding
+    // the observer are added by end time into a suffix-max tree over their
+    // start time, which is then queried for pushes following PUSH(a)
+    std::vector<std::pair<op_ptr, const value_ops*>> observers;
+    for (auto& [value, v] : values) {
+      if (v.pop) observers.emplace_back(v.pop, &v);
+      for (op_ptr peek : v.peeks) observers.emplace_back(peek, &v);
+    }
+    std::sort(observers.begin(), observers.end(), [](auto& a, auto& b) {
+      return a.first->startTime < b.first->startTime;
+    });
+
+    const std::size_t m = by_push_start.size();
+    std::vector<time_type> starts(m), tree(m + 1, 0);
+    for (std::size_t j = 0; j < m; ++j)
+      starts[j] = by_push_start[j]->push->startTime;
+    std::unordered_map<const value_ops*, std::size_t> rank;
+    for (std::size_t j = 0; j < m; ++j) rank[by_push_start[j]] = j;
+
+    i = 0;
+    for (auto [t, a] : observers) {
+      for (; i < m && precedes(by_push_end[i]->push, t); ++i)
+        for (std::size_t r = m - rank[by_push_end[i]]; r <= m; r += r & -r)
+          tree[r] = std::max(tree[r], key(*by_push_end[i]));
+
+      std::size_t lo = std::lower_bound(starts.begin(), starts.end(),
+                                        a->push->endTime) -
+                       starts.begin();
+      time_type latest = 0;
+      for (std::size_t r = m - lo; r; r -= r & -r)
+        latest = std::max(latest, tree[r]);
+      if (lo < m && latest >= t->endTime) return true;
+    }
+    return false;
+  }
+
+  // pushes go bottom-first, or most urgent first when `lazy`
+  bool simulate(history_t<value_type>& hist, bool lazy) {
+    const std::size_t n = hist.size();
+    op_ptr base = hist.data();
+    std::vector<op_ptr> by_start, by_end;
+    for (auto& o : hist) by_start.push_back(&o);
+    by_end = by_start;
+    std::sort(by_start.begin(), by_start.end(),
+              [](op_ptr a, op_ptr b) { return a->startTime < b->startTime; });
+    std::sort(by_end.begin(), by_end.end(),
+              [](op_ptr a, op_ptr b) { return a->endTime < b->endTime; });
+    std::sort(empties.begin(), empties.end(),
+              [](op_ptr a, op_ptr b) { return a->endTime < b->endTime; });
+    std::vector<op_ptr> unpopped;
+    for (auto& [value, v] : values) {
+      v.unavailable = (v.pop ? 1 : 0) + v.peeks.size();
+      v.next_peek = 0;
+      v.available_peeks.clear();
+      if (!v.pop) unpopped.push_back(v.push);
+    }
+    std::sort(unpopped.begin(), unpopped.end(),
+              [](op_ptr a, op_ptr b) { return a->endTime < b->endTime; });
+
+    std::vector<bool> placed(n), available(n);
+    std::vector<op_ptr> available_empties, ready;
+    std::set<push_order> pushes;
+    std::set<std::pair<time_type, op_ptr>> urgent;  // by push end
+    std::vector<value_type> st;
+    std::size_t next_start = 0, next_end = 0, next_empty = 0,
+                next_unpopped = 0;
+
+    // end of the first unplaced operation in a list sorted by end time
+    auto first_end = [&](const std::vector<op_ptr>& ops, std::size_t& i) {
+      while (i < ops.size() && placed[ops[i] - base]) ++i;
+      return i < ops.size() ? ops[i]->endTime : MAX_TIME;
+    };
+
+    auto make_ready = [&](value_ops& v) {
+      if (!v.pop || v.unavailable || !available[v.push - base] ||
+          placed[v.push - base])
+        return;
+      pushes.erase(order(v));
+      urgent.erase({v.push->endTime, v.push});
+      ready.push_back(v.push);
+    };
+
+    // marks operations starting before every unplaced one ends as available
+    auto advance = [&]() {
+      while (next_end < n && placed[by_end[next_end] - base]) ++next_end;
+      time_type min_end = next_end < n ? by_end[next_end]->endTime : MAX_TIME;
+
+      for (; next_start < n && by_start[next_start]->startTime < min_end;
+           ++next_start) {
+        op_ptr a = by_start[next_start];
+        available[a - base] = true;
+        if (is_empty_op(a)) {
+          available_empties.push_back(a);
+          continue;
+        }
+        value_ops& v = values[a->value];
+        if (a->method == Method::PEEK) v.available_peeks.push_back(a);
+        if (a->method == Method::PUSH) {
+          pushes.insert(order(v));
+          urgent.emplace(a->endTime, a);
+        } else {
+          --v.unavailable;
+        }
+        make_ready(v);
+      }
+    };
+
+    auto place = [&](op_ptr o) {
+      placed[o - base] = true;
+      advance();
+    };
+
+    advance();
+    for (std::size_t cnt = 0; cnt < n; ++cnt) {
+      if (st.empty() && !available_empties.empty()) {
+        op_ptr o = available_empties.back();
+        available_empties.pop_back();
+        place(o);
+        continue;
+      }
+
+      // pushes of popped values must clear off before `bound`, while those
+      // of never popped values must not cover anything still observed
+      time_type bound = first_end(unpopped, next_unpopped);
+      bool unpopped_ok = true;
+      if (st.empty()) {
+        time_type empty_end = first_end(empties, next_empty);
+        bound = std::min(bound, empty_end);
+        unpopped_ok = empty_end == MAX_TIME;
+      } else {
+        value_ops& v = values[st.back()];
+        if (!v.available_peeks.empty()) {
+          op_ptr o = v.available_peeks.back();
+          v.available_peeks.pop_back();
+          place(o);
+          continue;
+        }
+        time_type peek_end = first_end(v.peeks, v.next_peek);
+        if (peek_end == MAX_TIME && v.pop && available[v.pop - base]) {
+          place(v.pop);
+          st.pop_back();
+          continue;
+        }
+        bound = std::min(bound, peek_end);
+        if (v.pop) bound = std::min(bound, v.pop->endTime);
+        unpopped_ok = !v.pop && peek_end == MAX_TIME;
+      }
+
+      op_ptr push = nullptr;
+      if (!ready.empty()) {
+        push = ready.back();
+        ready.pop_back();
+      } else {
+        auto compatible = [&](const value_ops& v) {
+          return v.pop ? v.pop->startTime < bound : unpopped_ok;
+        };
+        std::vector<value_ops*> cands;
+        value_ops* u = nullptr;
+        if (lazy) {
+          // the most urgent one, or what has to go below it first
+          for (auto it = urgent.begin();
+               it != urgent.end() && cands.size() < WINDOW; ++it)
+            cands.push_back(&values[it->second->value]);
+          u = cands.empty() ? nullptr : cands.front();
+          for (std::size_t i = 0; u && i < cands.size(); ++i) {
+            auto below = std::find_if(cands.begin(), cands.end(), [&](auto x) {
+              return x != u && !can_stay_below(*u, *x);
+            });
+            if (below == cands.end()) break;
+            u = *below;
+          }
+          if (u && !compatible(*u)) {
+            auto it = std::find_if(cands.begin(), cands.end(),
+                                   [&](auto x) { return compatible(*x); });
+            u = it == cands.end() ? nullptr : *it;
+          }
+        } else {
+          // never popped values if they can go on top, then popped values
+          // that can be popped in time, latest first
+          auto it = pushes.rbegin();
+          if (!unpopped_ok) {
+            it = std::make_reverse_iterator(
+                pushes.lower_bound({MAX_TIME, 0, nullptr}));
+          }
+          auto last = std::make_reverse_iterator(pushes.begin());
+          for (; it != last && cands.size() < WINDOW; ++it) {
+            value_ops& v = values[std::get<2>(*it)->value];
+            if (!compatible(v)) {
+              // skip to popped values that can be popped in time
+              it = std::prev(std::make_reverse_iterator(
+                  pushes.lower_bound({bound, 0, nullptr})));
+              continue;
+            }
+            cands.push_back(&v);
+          }
+          // the one every other candidate stays above with the most room
+          slack_type most = 0;
+          for (value_ops* x : cands) {
+            slack_type least = std::numeric_limits<slack_type>::max();
+            for (value_ops* y : cands)
+              if (x != y) least = std::min(least, slack(*x, *y));
+            if (!u || least > most) {
+              most = least;
+              u = x;
+            }
+          }
+        }
+        if (u) {
+          push = u->push;
+          pushes.erase(order(*u));
+          urgent.erase({push->endTime, push});
+        }
+      }
+      if (!push) return false;
+      place(push);
+      st.push_back(push->value);
+    }
+    return true;
+  }
+
+  std::unordered_map<value_type, value_ops> values;
+  std::vector<op_ptr> empties;
+};
+
+template <typename value_type>
+bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
+  if (greedy::is_linearizable<value_type, stack_impl<value_type>>(hist, ctx)) {
+    ctx.engine = Engine::GREEDY;
+    return true;
+  }
+  if (distinct_values<Method::PUSH>(hist)) {
+    ctx.engine = Engine::DISTINCT_STACK;
+    std::optional<bool> res =
+        distinct_impl<value_type>().is_linearizable(hist, ctx);
+    if (res) return *res;
+  }
+  if (jit::preferred(hist, ctx, 3))
+    return jit::is_linearizable<value_type, stack_impl<value_type>>(hist, ctx);
+  ctx.engine = Engine::UNAMB_CFG;
   handle_empty(hist);
   make_match(hist);
-  return unamb_cfg::impl<value_type, stack_grammar<value_type>>()
-      .is_linearizable(hist);
+  return unamb_cfg::impl<value_type, stack_grammar<value_type>>(ctx.memory)
+      .is_linearizable(hist, ctx);
 }
 
 }  // namespace stack
@@ -1,12 +1,19 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <memory_resource>
 #include <optional>
 #include <queue>
+#include <string>
+#include <unordered_set>
 #include <utility>
 #include <variant>
+#include <vector>
 
+#include "arena.h"
 #include "frontier_graph.h"
+#include "monitor_context.h"
 
 namespace fptlin {
 
@@ -24,43 +31,114 @@ concept cfg_type =
       } -> std::convertible_to<std::optional<typename T::non_terminal>>;
     };
 
+/**
+ * Grammars with an additive `weight` of operations, such that `entry_mul` only
+ * yields `START_SYMBOL`, derived by segments of weight 0, and non-terminals
+ * that `init_entry` yields for operations of the same weight as the segments
+ * deriving them. Entries of segments of any other weight are never computed.
+ */
+template <typename T, typename value_type>
+concept weighted_cfg =
+    cfg_type<T, value_type> && requires(operation_t<value_type>* optr) {
+      { T::weight(optr) } -> std::convertible_to<uint64_t>;
+    };
+
 template <typename value_type, cfg_type<value_type> cfg>
 struct impl {
   using non_terminal = typename cfg::non_terminal;
 
   // Sparse, memory-efficient matrix row
-  using dp_row_t = std::unordered_map<std::size_t, non_terminal>;
-  using dp_table_t = std::vector<dp_row_t>;
+  using dp_row_t = std::pmr::unordered_map<std::size_t, non_terminal>;
+  using dp_table_t = std::pmr::vector<dp_row_t>;
 
   using entry_index_t = std::size_t;
+  using index_map_t = std::pmr::unordered_map<node, entry_index_t, node_hash>;
   using entry_order_t =
       std::vector<std::pair<int, std::pair<entry_index_t, entry_index_t>>>;
 
   static constexpr non_terminal START_SYMBOL = cfg::START_SYMBOL;
 
  public:
-  bool is_linearizable(history_t<value_type>& hist) {
+  // `memory` as `monitor_context::memory` of the checks
+  explicit impl(
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : fgraph(memory) {}
+
+  bool is_linearizable(history_t<value_type>& hist, monitor_context& ctx) {
     // in the context of linearizability,
     // empty histories can be assumed to be linearizable
     if (hist.empty()) return true;
+    require_proc_bits(hist);
 
-    events_t<value_type> events = get_events(hist);
-    std::sort(events.begin(), events.end());
-    fgraph.build(events);
+    events_t<value_type> events;
+    {
+      scoped_phase phase(ctx.stats, Phase::SORT);
+      events = get_events(hist);
+      std::sort(events.begin(), events.end());
+    }
+    ctx.progress.layers = events.size();
+    {
+      scoped_phase phase(ctx.stats, Phase::GRAPH_BUILD);
+      fgraph.build(events, ctx);
+    }
     std::size_t graph_size = fgraph.size();
+    ctx.stats.add(Counter::GRAPH_NODES, graph_size);
 
-    dp_table_t dp_table;
-    std::unordered_map<node, entry_index_t, node_hash> indices;
-    std::vector<node> index_to_node;  // new vector
+    arena_held<dp_table_t> held_table(ctx.memory);
+    arena_held<index_map_t> held_indices(ctx.memory);
+    dp_table_t& dp_table = *held_table;
+    index_map_t& indices = *held_indices;
+    std::pmr::vector<node> index_to_node(ctx.memory);
     indices.reserve(graph_size);
     index_to_node.reserve(graph_size);
     dp_table.resize(graph_size);
 
-    init_mats(dp_table, indices, index_to_node);
+    {
+      scoped_phase phase(ctx.stats, Phase::DP);
+      init_mats(dp_table, indices, index_to_node);
+    }
 
     // Precompute traversal order efficiently
-    for (auto [dist, entry_pos] : entry_order(indices, index_to_node))
-      calc_entry(entry_pos.first, entry_pos.second, dp_table);
+    entry_order_t order;
+    std::size_t sources = 0, pruned = 0;
+
+    uint64_t hist_fingerprint = ctx.checkpointing() || ctx.resume
+                                    ? fingerprint(hist)
+                                    : 0;
+    if (auto state = ctx.take_resume(Engine::UNAMB_CFG, hist_fingerprint))
+      ctx.progress.dp_done =
+          restore(*state, dp_table, indices.size(), order, sources, pruned);
+
+    // the graph is built again on resuming, as it is cheap next to the rest
+    auto save_checkpoint = [&] {
+      ctx.save_checkpoint(
+          Engine::UNAMB_CFG, hist_fingerprint,
+          save(dp_table, indices.size(), order, sources, pruned,
+               ctx.progress.dp_done));
+    };
+    try {
+      {
+        scoped_phase phase(ctx.stats, Phase::ENTRY_ORDER);
+        entry_order(indices, index_to_node, order, sources, pruned, ctx,
+                    save_checkpoint);
+      }
+      scoped_phase phase(ctx.stats, Phase::DP);
+      ctx.progress.dp_entries = order.size();
+      for (std::size_t i = ctx.progress.dp_done; i < order.size(); ++i) {
+        if (ctx.checkpoint_due) save_checkpoint();
+        ctx.step();
+        calc_entry(order[i].second.first, order[i].second.second, dp_table);
+        ++ctx.progress.dp_done;
+      }
+    } catch (const budget_exhausted&) {
+      if (ctx.checkpointing()) save_checkpoint();
+      // as far as the entries were ordered
+      ctx.stats.add(Counter::DP_ENTRIES, order.size());
+      ctx.stats.add(Counter::DP_PRUNED, pruned);
+      throw;
+    }
+    ctx.stats.add(Counter::DP_ENTRIES, order.size());
+    ctx.stats.add(Counter::DP_PRUNED, pruned);
 
     node dest = fgraph.first_same_node({static_cast<int>(events.size()), 0U});
     auto it_src = indices.find({0, 0});
@@ -72,9 +150,8 @@ struct impl {
   }
 
  private:
-  void init_mats(dp_table_t& dp_table,
-                 std::unordered_map<node, entry_index_t, node_hash>& indices,
-                 std::vector<node>& index_to_node) {
+  void init_mats(dp_table_t& dp_table, index_map_t& indices,
+                 std::pmr::vector<node>& index_to_node) {
     const auto& adj = fgraph.adj_list();
 
     for (auto& [a, v] : adj) {
@@ -101,6 +178,62 @@ struct impl {
     }
   }
 
+  // `order` as far as `sources` of the `nodes`, then, once all are ordered, the
+  // table as far as `done` entries, since entries are computed in `order`
+  std::string save(const dp_table_t& dp_table, std::size_t nodes,
+                   const entry_order_t& order, std::size_t sources,
+                   std::size_t pruned, std::size_t done) const {
+    checkpoint_writer w;
+    w.put(dp_table.size());
+    w.put(nodes);
+    w.put(sources);
+    w.put(pruned);
+    w.put(order.size());
+    for (const auto& [dist, entry] : order) {
+      w.put(dist);
+      w.put(entry);
+    }
+    if (sources < nodes) return w.data;
+
+    w.put(done);
+    for (const dp_row_t& row : dp_table) {
+      w.put(row.size());
+      for (const auto& [col, symbol] : row) {
+        w.put(col);
+        w.put(symbol);
+      }
+    }
+    return w.data;
+  }
+
+  // returns the number of entries computed
+  std::size_t restore(const std::string& state, dp_table_t& dp_table,
+                      std::size_t nodes, entry_order_t& order,
+                      std::size_t& sources, std::size_t& pruned) const {
+    checkpoint_reader r(state);
+    if (r.get<std::size_t>() != dp_table.size() ||
+        r.get<std::size_t>() != nodes)
+      throw std::invalid_argument("Checkpoint is of another history");
+    sources = r.get<std::size_t>();
+    pruned = r.get<std::size_t>();
+    order.resize(r.get<std::size_t>());
+    for (auto& [dist, entry] : order) {
+      dist = r.get<int>();
+      entry = r.get<std::pair<entry_index_t, entry_index_t>>();
+    }
+    if (sources < nodes) return 0;
+
+    std::size_t done = r.get<std::size_t>();
+    for (dp_row_t& row : dp_table) {
+      row.clear();
+      for (std::size_t n = r.get<std::size_t>(); n; --n) {
+        std::size_t col = r.get<std::size_t>();
+        row.emplace(col, r.get<non_terminal>());
+      }
+    }
+    return done;
+  }
+
   void calc_entry(entry_index_t a, entry_index_t b, dp_table_t& dp_table) {
     auto& row_a = dp_table[a];
     for (const auto& [c, entry_ac] : row_a) {
@@ -111,46 +244,76 @@ struct impl {
     }
   }
 
-  entry_order_t entry_order(
-      const std::unordered_map<node, entry_index_t, node_hash>& indices,
-      const std::vector<node>& index_to_node) {
+  // the pairs of nodes whose entries may be non-empty, in an order in which
+  // the entries they are computed from come first, with the number of other
+  // connected pairs in `pruned`; continues from the first `sources` nodes,
+  // whose pairs are in `order` and `pruned` already, and calls
+  // `save_checkpoint` between sources when due
+  //
+  // Every path between two nodes linearizes the same operations, so only pairs
+  // at least two operations apart are kept, and for a `weighted_cfg` only
+  // those of a weight some non-terminal may have. Every node lies on a path
+  // from the first to the last, so reachability alone would prune nothing.
+  template <typename save_fn>
+  void entry_order(const index_map_t& indices,
+                   const std::pmr::vector<node>& index_to_node,
+                   entry_order_t& order, std::size_t& sources,
+                   std::size_t& pruned, monitor_context& ctx,
+                   save_fn save_checkpoint) {
     const std::size_t n = indices.size();
-    entry_order_t ret;
+    if (sources == n) return;
 
     std::vector<int> dist(n, -1);
     std::queue<entry_index_t> q;
     const auto& adj = fgraph.adj_list();
 
-    for (entry_index_t src = 0; src < n; ++src) {
+    // of the operations on the way from the source
+    std::vector<uint64_t> weight(n);
+    std::unordered_set<uint64_t> weights{0};
+    if constexpr (weighted_cfg<cfg, value_type>)
+      for (const auto& [a, v] : adj)
+        for (const auto& [b, optr] : v) weights.insert(cfg::weight(optr));
+
+    for (; sources < n; ++sources) {
+      if (ctx.checkpoint_due) save_checkpoint();
+      const entry_index_t src = sources;
       std::fill(dist.begin(), dist.end(), -1);
       dist[src] = 0;
+      weight[src] = 0;
       q.push(src);
 
       while (!q.empty()) {
         const entry_index_t u = q.front();
         q.pop();
+        ctx.step();
 
         const node& u_node = index_to_node[u];
         auto it = adj.find(u_node);
         if (it == adj.end()) continue;
 
-        for (const auto& [vnode, _] : it->second) {
+        for (const auto& [vnode, optr] : it->second) {
           auto v_it = indices.find(vnode);
           if (v_it == indices.end()) continue;
           const entry_index_t v = v_it->second;
           if (dist[v] == -1) {
             dist[v] = dist[u] + 1;
+            if constexpr (weighted_cfg<cfg, value_type>)
+              weight[v] = weight[u] + cfg::weight(optr);
             q.push(v);
           }
         }
       }
 
-      for (entry_index_t i = 0; i < n; ++i)
-        if (dist[i] != -1) ret.push_back({dist[i], {src, i}});
+      for (entry_index_t i = 0; i < n; ++i) {
+        if (dist[i] == -1) continue;
+        if (dist[i] >= 2 && weights.contains(weight[i]))
+          order.push_back({dist[i], {src, i}});
+        else
+          ++pruned;
+      }
     }
 
-    std::sort(ret.begin(), ret.end());
-    return ret;
+    std::sort(order.begin(), order.end());
   }
 
   frontier_graph<value_type> fgraph;
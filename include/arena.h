@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+namespace fptlin {
+
+/**
+ * Memory resource that hands out memory from large chunks and frees it all
+ * at once, for the graphs, tables and sets that engines grow for the length
+ * of a check. Deallocation does nothing.
+ *
+ * `reset` keeps up to `retain` bytes of chunks, so that a batch of checks
+ * mostly reuses memory that is already mapped.
+ */
+class arena final : public std::pmr::memory_resource {
+ public:
+  // chunks double in size from the first to the last, so that the memory of
+  // an arena that is reset and filled again stays near what it holds
+  static constexpr std::size_t MIN_CHUNK = std::size_t(64) << 10;
+  static constexpr std::size_t MAX_CHUNK = std::size_t(64) << 20;
+
+  explicit arena(std::size_t retain = std::size_t(256) << 20)
+      : retain(retain) {}
+
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+
+  // frees everything allocated, which must no longer be in use
+  void reset() {
+    std::sort(chunks.begin(), chunks.end(),
+              [](const chunk& a, const chunk& b) { return a.size > b.size; });
+    std::size_t kept = 0, bytes = 0;
+    while (kept < chunks.size() && bytes + chunks[kept].size <= retain)
+      bytes += chunks[kept++].size;
+    chunks.resize(kept);
+    used = 0;
+    ptr = last = nullptr;
+  }
+
+  // bytes of the chunks held, in use or kept
+  std::size_t capacity() const {
+    std::size_t bytes = 0;
+    for (const chunk& c : chunks) bytes += c.size;
+    return bytes;
+  }
+
+ private:
+  struct chunk {
+    std::unique_ptr<std::byte[]> data;
+    std::size_t size;
+  };
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    for (;;) {
+      void* p = ptr;
+      std::size_t space = last - ptr;
+      if (p && std::align(alignment, bytes, p, space)) {
+        ptr = static_cast<std::byte*>(p) + bytes;
+        return p;
+      }
+      next_chunk(bytes + alignment);
+    }
+  }
+
+  void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  // moves to a chunk of at least `bytes`, reusing a kept one if large enough
+  void next_chunk(std::size_t bytes) {
+    auto spare = std::find_if(
+        chunks.begin() + used, chunks.end(),
+        [bytes](const chunk& c) { return c.size >= bytes; });
+    if (spare == chunks.end()) {
+      std::size_t size = std::max(bytes, MIN_CHUNK);
+      if (used)
+        size = std::max(size, std::min(chunks[used - 1].size * 2, MAX_CHUNK));
+      chunks.push_back(
+          {std::make_unique_for_overwrite<std::byte[]>(size), size});
+      spare = chunks.end() - 1;
+    }
+    std::iter_swap(chunks.begin() + used, spare);
+    chunk& c = chunks[used++];
+    ptr = c.data.get();
+    last = ptr + c.size;
+  }
+
+  std::size_t retain;
+
+  // chunks [0, used) are in use, the last of which is [ptr, last)
+  std::vector<chunk> chunks;
+  std::size_t used = 0;
+  std::byte* ptr = nullptr;
+  std::byte* last = nullptr;
+};
+
+/**
+ * A `T` that allocates all it holds from the `memory` it is constructed with,
+ * e.g. a pmr container of pmr containers, and that is not destroyed when
+ * `memory` is an `arena`, which frees it all at once on `reset`. For the sets
+ * and tables engines grow, which would otherwise take about as long to destroy
+ * node by node as to fill, e.g. after a search runs out of time.
+ */
+template <typename T>
+class arena_held {
+ public:
+  explicit arena_held(std::pmr::memory_resource* memory)
+      : memory(memory), in_arena(dynamic_cast<arena*>(memory)) {
+    ::new (&value) T(memory);
+  }
+
+  arena_held(const arena_held&) = delete;
+  arena_held& operator=(const arena_held&) = delete;
+
+  ~arena_held() {
+    if (!in_arena) value.~T();
+  }
+
+  // replaces the `T` with an empty one; an arena, which must then hold
+  // nothing else, is reset rather than the `T` cleared
+  void clear() {
+    if (!in_arena) {
+      value.clear();
+      return;
+    }
+    in_arena->reset();
+    ::new (&value) T(memory);
+  }
+
+  T& operator*() { return value; }
+  const T& operator*() const { return value; }
+  T* operator->() { return &value; }
+  const T* operator->() const { return &value; }
+
+ private:
+  union {
+    T value;
+  };
+  std::pmr::memory_resource* memory;
+  arena* in_arena;
+};
+
+}  // namespace fptlin
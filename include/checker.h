@@ -0,0 +1,113 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "arena.h"
+#include "definitions.h"
+#include "monitor_context.h"
+#include "thread_pool.h"
+
+namespace fptlin {
+
+/**
+ * How much of a history that only grows at its end has been checked, so that
+ * later checks only cover what was appended since. Only the operations before
+ * the last quiescent point, which no operation spans, are covered.
+ */
+struct incremental_state {
+  // operations covered, the last of which ended at `last_end`; appended
+  // operations must start after it
+  std::size_t ops = 0;
+  time_type last_end = 0;
+
+  // whether the covered operations are, in which case `model` holds the state
+  // of the object after them
+  bool linearizable = true;
+  std::string model;
+
+  // leading operations of the history last checked that are now covered
+  std::size_t advanced = 0;
+};
+
+// thrown by incremental checks given an operation that starts before the
+// operations covered end, e.g. as the history was rewritten
+struct overlapping_operation : std::invalid_argument {
+  using std::invalid_argument::invalid_argument;
+};
+
+struct check_result {
+  // only meaningful if `decided`
+  bool linearizable;
+
+  // false if a budget of `checker::limits` ran out first
+  bool decided;
+
+  // engine that decided the result, or was running when the budget ran out
+  Engine engine;
+
+  monitor_progress progress;
+
+  monitor_stats stats;
+};
+
+/**
+ * Checks histories held in memory, with one member function per data type in
+ * `FPTLIN_ADT_EXPAND`, e.g. `check_stack`.
+ *
+ * Engines reorder and prune the histories they are given, so each history is
+ * first copied into a buffer owned by the checker, which keeps its capacity
+ * across calls, as does the `arena` the engines allocate from. A checker must
+ * not be shared between threads, though it runs one of its own for races.
+ *
+ * Implemented in `libfptlin`, so that including this header does not pull in
+ * the engines.
+ */
+class checker {
+ public:
+  // `perf`, if set, is read per phase when built with `FPTLIN_STATS`
+  explicit checker(perf_counters* perf = nullptr) : perf(perf) {}
+
+#define FPTLIN_CHECKER_DECLARE(ADT, ...) \
+  check_result check_##ADT(              \
+      std::span<const operation_t<pack_type<__VA_ARGS__>>> hist);
+  FPTLIN_ADT_EXPAND(FPTLIN_CHECKER_DECLARE)
+#undef FPTLIN_CHECKER_DECLARE
+
+  // checks the operations appended to those covered by `state`, and advances
+  // it; throws `overlapping_operation` if one starts before `state.last_end`
+#define FPTLIN_CHECKER_DECLARE_INCREMENTAL(ADT, ...)             \
+  check_result check_##ADT(                                      \
+      std::span<const operation_t<pack_type<__VA_ARGS__>>> hist, \
+      incremental_state& state);
+  FPTLIN_AADT_EXPAND(FPTLIN_CHECKER_DECLARE_INCREMENTAL)
+#undef FPTLIN_CHECKER_DECLARE_INCREMENTAL
+
+  // applied to every check; only the FPT engines take checkpoints, and
+  // incremental checks take `Strategy::AUTO` for `Strategy::RACE`
+  monitor_limits limits;
+  checkpoint_options checkpoints;
+  Strategy strategy = Strategy::AUTO;
+
+  // continued by the next check, which must be of the same history
+  std::optional<checkpoint> resume;
+
+ private:
+  [[maybe_unused]] perf_counters* perf;
+
+  arena memory;
+
+  // of the `jit` side of races, made by the first
+  std::unique_ptr<thread_pool> racer;
+  arena race_memory;
+
+#define FPTLIN_CHECKER_BUFFER(ADT, ...) \
+  history_t<pack_type<__VA_ARGS__>> ADT##_buffer;
+  FPTLIN_ADT_EXPAND(FPTLIN_CHECKER_BUFFER)
+#undef FPTLIN_CHECKER_BUFFER
+};
+
+}  // namespace fptlin
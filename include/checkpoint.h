@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "definitions.h"
+#include "history_writer.h"
+
+namespace fptlin {
+
+/**
+ * Binary encoding of checkpoints: integers and enums as LEB128 varints,
+ * pairs and tuples member-wise, strings prefixed by their length.
+ */
+struct checkpoint_writer {
+  template <typename T>
+  void put(const T& value) {
+    if constexpr (std::is_enum_v<T>) {
+      put(static_cast<uint64_t>(std::to_underlying(value)));
+    } else if constexpr (std::is_same_v<T, bool>) {
+      data.push_back(value);
+    } else if constexpr (std::is_integral_v<T>) {
+      // zigzag, so that small negative values stay short
+      uint64_t v = static_cast<uint64_t>(value);
+      if constexpr (std::is_signed_v<T>)
+        v = (v << 1) ^ uint64_t(static_cast<int64_t>(value) >> 63);
+      for (; v >= 0x80; v >>= 7) data.push_back(char(v | 0x80));
+      data.push_back(char(v));
+    } else {
+      std::apply([this](const auto&... members) { (put(members), ...); },
+                 value);
+    }
+  }
+
+  void put(const std::string& str) {
+    put(str.size());
+    data += str;
+  }
+
+  std::string data;
+};
+
+struct checkpoint_reader {
+  explicit checkpoint_reader(std::string_view data) : data(data) {}
+
+  template <typename T>
+  T get() {
+    if constexpr (std::is_enum_v<T>) {
+      return static_cast<T>(get<uint64_t>());
+    } else if constexpr (std::is_same_v<T, bool>) {
+      return next();
+    } else if constexpr (std::is_integral_v<T>) {
+      uint64_t v = 0;
+      for (int shift = 0;; shift += 7) {
+        uint8_t byte = next();
+        v |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+      }
+      if constexpr (std::is_signed_v<T>) v = (v >> 1) ^ -(v & 1);
+      return static_cast<T>(v);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      std::size_t size = get<std::size_t>();
+      if (size > data.size())
+        throw std::invalid_argument("Truncated checkpoint");
+      std::string str{data.substr(0, size)};
+      data.remove_prefix(size);
+      return str;
+    } else {
+      return get_members<T>(
+          std::make_index_sequence<std::tuple_size_v<T>>());
+    }
+  }
+
+  bool done() const { return data.empty(); }
+
+ private:
+  template <typename T, std::size_t... I>
+  T get_members(std::index_sequence<I...>) {
+    // braced initialisation keeps the members in order
+    return T{get<std::tuple_element_t<I, T>>()...};
+  }
+
+  uint8_t next() {
+    if (data.empty()) throw std::invalid_argument("Truncated checkpoint");
+    uint8_t byte = data.front();
+    data.remove_prefix(1);
+    return byte;
+  }
+
+  std::string_view data;
+};
+
+// replaces `path` atomically, so that a kill while writing leaves the previous
+// contents intact; concurrent writers each write a file of their own, and the
+// last to rename it wins
+inline void replace_file(const std::string& path, std::string_view data) {
+  std::string tmp = path + ".tmp" + std::to_string(std::random_device()());
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    f << data;
+    if (!f.flush()) throw std::runtime_error("Failed to write " + tmp);
+  }
+  std::filesystem::rename(tmp, path);
+}
+
+/**
+ * State of a check in progress, taken periodically by the engines that
+ * support it so that the check can be resumed after the process is killed.
+ */
+struct checkpoint {
+  static constexpr std::string_view MAGIC = "FPTLINCK";
+  static constexpr uint32_t VERSION = 2;
+
+  // what was being checked, e.g. the path of the history
+  std::string source;
+
+  Engine engine;
+
+  // of the history given to `engine`, see `fingerprint`
+  uint64_t fingerprint;
+
+  // specific to `engine`
+  std::string state;
+
+  void save(const std::string& path) const {
+    checkpoint_writer w;
+    w.put(VERSION);
+    w.put(source);
+    w.put(engine);
+    w.put(fingerprint);
+    w.put(state);
+    replace_file(path, std::string(MAGIC) + w.data);
+  }
+
+  static checkpoint load(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) throw std::invalid_argument("Failed to read " + path);
+    std::string data{std::istreambuf_iterator<char>(f), {}};
+    if (!data.starts_with(MAGIC))
+      throw std::invalid_argument(path + " is not a checkpoint");
+
+    checkpoint_reader r(std::string_view(data).substr(MAGIC.size()));
+    if (r.get<uint32_t>() != VERSION)
+      throw std::invalid_argument(path + " is of another version");
+    checkpoint c;
+    c.source = r.get<std::string>();
+    c.engine = r.get<Engine>();
+    c.fingerprint = r.get<uint64_t>();
+    c.state = r.get<std::string>();
+    return c;
+  }
+};
+
+// FNV-1a, continuing from `h` to hash data in pieces
+inline uint64_t fnv1a(std::string_view data,
+                      uint64_t h = 0xcbf29ce484222325ull) {
+  for (char c : data) h = (h ^ uint8_t(c)) * 0x100000001b3ull;
+  return h;
+}
+
+// of every operation in order, as written by `write_history`, continuing from
+// `h`
+template <typename value_type>
+uint64_t fingerprint(const history_t<value_type>& hist,
+                     uint64_t h = fnv1a("")) {
+  std::ostringstream os;
+  for (auto& o : hist) {
+    os.str("");
+    os << o.proc << ' ' << o.startTime << ' ' << o.endTime << ' '
+       << o.method << ' ';
+    write_value(os, o.value);
+    os << '\n';
+    h = fnv1a(os.view(), h);
+  }
+  return h;
+}
+
+}  // namespace fptlin
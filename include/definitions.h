@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <limits>
 #include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 namespace fptlin {
@@ -24,7 +27,9 @@ namespace fptlin {
   MACRO(CONTAINS)                   \
   MACRO(INCR)                       \
   MACRO(DECR)                       \
-  MACRO(READ_MODIFY_WRITE)
+  MACRO(READ_MODIFY_WRITE)          \
+  MACRO(READ)                       \
+  MACRO(WRITE)
 
 enum Method {
 #define FPTLIN_METHOD_LIST(ENUM) ENUM,
@@ -52,9 +57,42 @@ inline std::string methodtos(const Method& method) {
 #undef FPTLIN_METHODSTR_TRANSLATE
 }
 
+#define FPTLIN_ENGINE_EXPAND(MACRO) \
+  MACRO(GREEDY)                     \
+  MACRO(AADT)                       \
+  MACRO(UNAMB_CFG)                  \
+  MACRO(FRONTIER_QUEUE)             \
+  MACRO(DISTINCT_QUEUE)             \
+  MACRO(DISTINCT_STACK)             \
+  MACRO(JIT)                        \
+  MACRO(DISTINCT_REGISTER)
+
+enum Engine {
+#define FPTLIN_ENGINE_LIST(ENUM) ENUM,
+  FPTLIN_ENGINE_EXPAND(FPTLIN_ENGINE_LIST)
+#undef FPTLIN_ENGINE_LIST
+};
+
+inline std::string enginetos(const Engine& engine) {
+#define FPTLIN_ENGINESTR_TRANSLATE(ENUM) \
+  case ENUM:                             \
+    return #ENUM;
+  switch (engine) {
+    FPTLIN_ENGINE_EXPAND(FPTLIN_ENGINESTR_TRANSLATE)
+    default:
+      throw std::invalid_argument("Unknown engine: " + std::to_string(engine));
+  }
+#undef FPTLIN_ENGINESTR_TRANSLATE
+}
+
+// to be bumped by any change to an engine that may change a result, which
+// invalidates the results kept by `result_cache`
+constexpr uint32_t ENGINE_VERSION = 3;
+
 typedef unsigned long long time_type;
 typedef unsigned int id_type;
 typedef unsigned int proc_type;
+typedef int default_value_type;
 
 // As operations are assumed to be complete, return values are known and can be
 // embedded within value_type if desired
@@ -75,4 +113,29 @@ template <typename value_type>
 using events_t =
     std::vector<std::tuple<time_type, bool, operation_t<value_type>*>>;
 
+// value type of operations carrying `Args`, packed as a tuple if more than one
+template <typename... Args>
+using pack_type = std::conditional_t<
+    (sizeof...(Args) == 1),
+    typename std::tuple_element<0, std::tuple<Args...>>::type,
+    std::tuple<Args...>>;
+
+// supported data types, with the value types histories of them are read as
+#define FPTLIN_ADT_EXPAND(VARIADIC_MACRO)                     \
+  VARIADIC_MACRO(stack, default_value_type)                   \
+  VARIADIC_MACRO(queue, default_value_type)                   \
+  VARIADIC_MACRO(priorityqueue, default_value_type)           \
+  VARIADIC_MACRO(rmw, default_value_type, default_value_type) \
+  VARIADIC_MACRO(rw_register, default_value_type)             \
+  VARIADIC_MACRO(semaphore, bool)                             \
+  VARIADIC_MACRO(set, default_value_type, bool)
+
+// those of `FPTLIN_ADT_EXPAND` checked by the aadt search, whose state only
+// depends on the operations applied, and not on their order
+#define FPTLIN_AADT_EXPAND(VARIADIC_MACRO)                    \
+  VARIADIC_MACRO(priorityqueue, default_value_type)           \
+  VARIADIC_MACRO(rmw, default_value_type, default_value_type) \
+  VARIADIC_MACRO(semaphore, bool)                             \
+  VARIADIC_MACRO(set, default_value_type, bool)
+
 }  // namespace fptlin
\ No newline at end of file
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <stdexcept>
+#include <string>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "definitions.h"
 
@@ -24,16 +30,111 @@ struct node_hash {
   }
 };
 
-bool operator==(const node& a, const node& b) noexcept {
+inline bool operator==(const node& a, const node& b) noexcept {
   return std::bit_cast<int64_t>(a) == std::bit_cast<int64_t>(b);
 }
 
 // for tie-breaking only, and does not imply actual ordering of the two
-bool operator<(const node& a, const node& b) noexcept {
+inline bool operator<(const node& a, const node& b) noexcept {
   return std::bit_cast<int64_t>(a) < std::bit_cast<int64_t>(b);
 }
 
-typedef std::unordered_set<node, node_hash> node_set;
+typedef std::pmr::unordered_set<node, node_hash> node_set;
+
+/**
+ * Set of nodes within a fixed number of bytes, for searches where dropping a
+ * node only costs exploring it again.
+ *
+ * Set-associative: a node can only be held by the `WAYS` slots of the set its
+ * hash selects. The number of sets doubles whenever one overflows, until the
+ * budget is reached, after which each set evicts by CLOCK, sparing nodes hit
+ * since the hand last passed them. Evicting by layer instead fares much worse
+ * under tight budgets, as nodes of low layers root the largest subtrees and
+ * nodes of high layers are revisited the most.
+ */
+struct node_cache {
+  static constexpr std::size_t WAYS = 8;
+
+  explicit node_cache(std::size_t bytes)
+      : max_sets(std::bit_floor(std::max<std::size_t>(
+            bytes / (sizeof(node) + sizeof(uint8_t)) / WAYS, 1))) {
+    resize(std::min<std::size_t>(max_sets, 1024));
+  }
+
+  // returns whether `v` was absent, like `node_set::insert(v).second`
+  bool insert(node v) {
+    std::size_t set = index(v);
+    std::size_t first = set * WAYS;
+    std::size_t free = slots.size();
+    for (std::size_t i = first; i < first + WAYS; ++i) {
+      if (slots[i] == v) {
+        referenced[i] = true;
+        return false;
+      }
+      if (slots[i].layer < 0 && free == slots.size()) free = i;
+    }
+
+    if (free == slots.size()) {
+      if (hands.size() < max_sets) {
+        grow();
+        return insert(v);
+      }
+      uint8_t& hand = hands[set];
+      for (; referenced[first + hand]; hand = (hand + 1) % WAYS)
+        referenced[first + hand] = false;
+      free = first + hand;
+      hand = (hand + 1) % WAYS;
+      ++evicted;
+    }
+    slots[free] = v;
+    referenced[free] = false;
+    ++inserted;
+    return true;
+  }
+
+  // currently held, e.g. to save them
+  std::vector<node> nodes() const {
+    std::vector<node> ret;
+    for (node v : slots)
+      if (v.layer >= 0) ret.push_back(v);
+    return ret;
+  }
+
+  std::size_t inserted = 0;
+  std::size_t evicted = 0;
+
+ private:
+  static constexpr node EMPTY{-1, 0};
+
+  // `node_hash` is the identity on most platforms, so mix before masking
+  std::size_t index(node v) const {
+    uint64_t h = std::bit_cast<uint64_t>(v) * 0x9e3779b97f4a7c15ull;
+    return (h ^ (h >> 32)) & (hands.size() - 1);
+  }
+
+  void resize(std::size_t sets) {
+    slots.assign(sets * WAYS, EMPTY);
+    referenced.assign(sets * WAYS, false);
+    hands.assign(sets, 0);
+  }
+
+  // each set splits into two, so reinserting never overflows
+  void grow() {
+    std::vector<node> old(std::move(slots));
+    resize(hands.size() << 1);
+    for (node v : old) {
+      if (v.layer < 0) continue;
+      std::size_t i = index(v) * WAYS;
+      while (slots[i].layer >= 0) ++i;
+      slots[i] = v;
+    }
+  }
+
+  std::size_t max_sets;
+  std::vector<node> slots;
+  std::vector<bool> referenced;
+  std::vector<uint8_t> hands;
+};
 
 template <typename... Args>
 std::ostream& operator<<(std::ostream& os, const std::tuple<Args...>& tuple) {
@@ -50,11 +151,42 @@ std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
-std::ostream& operator<<(std::ostream& os, const node& v) {
+inline std::ostream& operator<<(std::ostream& os, const node& v) {
   os << "[layer=" << v.layer << ", bits=" << v.bits << "]";
   return os;
 }
 
+// of a call, `true`, or a response, `false`, with ties broken as in sorted
+// events: responses before calls
+using instant = std::pair<time_type, bool>;
+
+// whether `a` responds before `b` is called, with ties broken as for `instant`
+template <typename value_type>
+bool precedes(const operation_t<value_type>* a,
+              const operation_t<value_type>* b) {
+  return a->endTime <= b->startTime;
+}
+
+// whether each process of `hist` has a bit of a `uint32_t`, as the engines
+// that track pending operations by process need
+template <typename value_type>
+bool fits_proc_bits(const history_t<value_type>& hist) {
+  return std::ranges::all_of(hist, [](const operation_t<value_type>& o) {
+    return o.proc < MAX_PROC_NUM;
+  });
+}
+
+// throws unless `fits_proc_bits(hist)`
+template <typename value_type>
+void require_proc_bits(const history_t<value_type>& hist) {
+  for (const operation_t<value_type>& o : hist)
+    if (o.proc >= MAX_PROC_NUM)
+      throw std::invalid_argument(
+          "Process " + std::to_string(o.proc) + " of operation " +
+          std::to_string(o.id) + " is beyond the " +
+          std::to_string(MAX_PROC_NUM) + " processes of this engine");
+}
+
 /**
  * retrieves events, O(n)
  */
@@ -90,4 +222,41 @@ std::vector<bit_pattern> get_bit_pattern(events_t<value_type>& events) {
   return ret;
 }
 
+/**
+ * Of two alike operations, i.e. of the same method and value, both pending,
+ * linearizing the one responding first first loses no linearization: swapping
+ * them in any other keeps its sequence of methods and values, and each within
+ * its interval.
+ *
+ * Sets `before[i]`, for each operation `ongoing[i]` of `set`, to those of `set`
+ * alike it that respond before it in sorted events, O(|set|^2)
+ */
+template <typename value_type>
+void alike_before(uint32_t set, operation_t<value_type>* const* ongoing,
+                  uint32_t* before) {
+  for (uint32_t x = set; x; x &= x - 1) {
+    const operation_t<value_type>* a = ongoing[std::countr_zero(x)];
+    uint32_t& mask = before[std::countr_zero(x)];
+    mask = 0;
+    for (uint32_t y = set; y; y &= y - 1) {
+      const operation_t<value_type>* b = ongoing[std::countr_zero(y)];
+      if (a->method == b->method && a->value == b->value &&
+          (b->endTime < a->endTime || (b->endTime == a->endTime && b < a)))
+        mask |= y & -y;
+    }
+  }
+}
+
+/**
+ * checks that no value is written twice by operations of `methods`, O(n)
+ */
+template <Method... methods, typename value_type>
+bool distinct_values(const history_t<value_type>& hist) {
+  std::unordered_set<value_type> seen;
+  for (const operation_t<value_type>& o : hist)
+    if (((o.method == methods) || ...) && !seen.insert(o.value).second)
+      return false;
+  return true;
+}
+
 }  // namespace fptlin
@@ -1,70 +1,98 @@
 #pragma once
 
+#include <algorithm>
+#include <memory_resource>
 #include <unordered_map>
+#include <vector>
 
+#include "arena.h"
 #include "fptlinutils.h"
+#include "monitor_context.h"
 
 namespace fptlin {
 
 template <typename value_type, Method... methods>
 struct frontier_graph {
   using frontier_list_t =
-      std::vector<std::pair<node, operation_t<value_type>*>>;
+      std::pmr::vector<std::pair<node, operation_t<value_type>*>>;
   using frontier_adj_list =
-      std::unordered_map<node, frontier_list_t, node_hash>;
-  using node_map = std::unordered_map<node, node, node_hash>;
+      std::pmr::unordered_map<node, frontier_list_t, node_hash>;
+  using node_map = std::pmr::unordered_map<node, node, node_hash>;
 
-  const frontier_list_t& next(const node& node) { return madj_list[node]; }
+  explicit frontier_graph(
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : parent_map(memory),
+        last_added_child_map(memory),
+        madj_list(memory) {}
 
-  const frontier_adj_list& adj_list() const { return madj_list; }
+  const frontier_list_t& next(const node& node) { return (*madj_list)[node]; }
 
-  node first_same_node(const node& node) { return parent_map[node]; }
+  const frontier_adj_list& adj_list() const { return *madj_list; }
+
+  node first_same_node(const node& node) { return (*parent_map)[node]; }
 
   node last_same_node(const node& first_node) {
-    auto iter = last_added_child_map.find(first_node);
-    return iter == last_added_child_map.end() ? first_node : iter->second;
+    auto iter = last_added_child_map->find(first_node);
+    return iter == last_added_child_map->end() ? first_node : iter->second;
   }
 
-  std::size_t size() const { return parent_map.size(); }
+  std::size_t size() const { return parent_map->size(); }
 
   /**
+   * Only nodes reachable from the first are built, and of alike pending
+   * operations only the one responding first is linearized by an edge, see
+   * `alike_before`. The nodes of a layer thus number the product of the sizes
+   * of its classes of alike operations, plus one each, rather than 2^k.
+   *
    * Joining is performed in increments of layer.
    * Resulting ufds will have depth of at most 1.
    * Hence, joining and finding are all O(1).
    */
-  void build(const events_t<value_type>& events) {
+  void build(const events_t<value_type>& events, monitor_context& ctx) {
     uint32_t max_bit = 0;
     operation_t<value_type>* ongoing[MAX_PROC_NUM];
+    uint32_t before[MAX_PROC_NUM];
+
+    // masks of the nodes reached in the current layer, then in the next
+    std::vector<uint32_t> masks{0}, next_masks;
     for (int layer = 0; std::cmp_less(layer, events.size()); ++layer) {
       auto [time, is_inv, optr] = events[layer];
+      ctx.reach(layer);
 
       bool ignore =
           (sizeof...(methods) > 0) && ((optr->method != methods) && ...);
       uint32_t opbit = ignore ? 0 : 1 << optr->proc;
       uint32_t crit_bit = is_inv ? 0 : opbit;
+      alike_before(max_bit, ongoing, before);
+
+      // `masks` grows with the nodes first reached by edges
+      next_masks.clear();
+      for (std::size_t i = 0; i < masks.size(); ++i) {
+        uint32_t sub = masks[i];
+        ctx.step();
 
-      // iterate through all sub-masks in shrinking order
-      for (uint32_t sub = max_bit;; sub = (sub - 1) & max_bit) {
         // union join
         node curr{layer, sub};
-        node first = parent_map.try_emplace(curr, curr).first->second;
+        node first = parent_map->try_emplace(curr, curr).first->second;
         if (!crit_bit || (crit_bit & sub)) {
           node last = {layer + 1, sub ^ crit_bit};
-          parent_map[last] = first;
-          last_added_child_map[first] = last;
+          (*parent_map)[last] = first;
+          (*last_added_child_map)[first] = last;
+          next_masks.push_back(last.bits);
         }
 
         // populate `adj_list`
         for (uint32_t x = (max_bit & ~sub); x; x &= (x - 1)) {
+          if (before[std::countr_zero(x)] & ~sub) continue;
           uint32_t curr_bit = x & -x;
           operation_t<value_type>* to_add = ongoing[std::countr_zero(x)];
           node next{layer, sub | curr_bit};
-          madj_list[first].emplace_back(
-              parent_map.try_emplace(next, next).first->second, to_add);
+          auto [it, reached] = parent_map->try_emplace(next, next);
+          (*madj_list)[first].emplace_back(it->second, to_add);
+          if (reached) masks.push_back(next.bits);
         }
-
-        if (sub == 0) break;
       }
+      std::swap(masks, next_masks);
 
       if (ignore) continue;
 
@@ -78,9 +106,159 @@ struct frontier_graph {
   }
 
  private:
-  node_map parent_map;
-  node_map last_added_child_map;
-  frontier_adj_list madj_list;
+  arena_held<node_map> parent_map;
+  arena_held<node_map> last_added_child_map;
+  arena_held<frontier_adj_list> madj_list;
+};
+
+/**
+ * `frontier_graph` built on demand, for searches that only reach part of it:
+ * the edges of a first node and its last same node are computed from the
+ * pattern of events when first asked for, and kept along with every node
+ * joined on the way, so that time and memory follow the nodes searched.
+ *
+ * Nodes are joined whether or not they are reachable from the first, so the
+ * edges of a first node may include those of joined nodes no search reaches,
+ * which linearize the same operations as its own.
+ */
+template <typename value_type, Method... methods>
+struct lazy_frontier_graph {
+  using frontier_list_t =
+      typename frontier_graph<value_type, methods...>::frontier_list_t;
+  using frontier_adj_list =
+      typename frontier_graph<value_type, methods...>::frontier_adj_list;
+  using node_map = typename frontier_graph<value_type, methods...>::node_map;
+
+  explicit lazy_frontier_graph(
+      std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : parent_map(memory),
+        last_map(memory),
+        madj_list(memory),
+        pattern(memory),
+        invocations(memory) {}
+
+  // `first` must be a first node
+  const frontier_list_t& next(const node& first) {
+    auto [it, added] = madj_list->try_emplace(first);
+    if (added) (*last_map)[first] = expand(first, it->second);
+    return it->second;
+  }
+
+  node first_same_node(const node& node) {
+    // back to the first node, or one joined before
+    fptlin::node curr = node, first = node;
+    path.clear();
+    for (;;) {
+      if (auto it = parent_map->find(curr); it != parent_map->end()) {
+        first = it->second;
+        break;
+      }
+      ctx->step();
+      path.push_back(curr);
+      if (curr.layer == 0 || (curr.bits & ~pattern[curr.layer - 1].max_bit)) {
+        first = curr;
+        break;
+      }
+      const bit_pattern& prev = pattern[curr.layer - 1];
+      curr = {curr.layer - 1, curr.bits | prev.critical_bit};
+    }
+    for (const fptlin::node& joined : path) parent_map->emplace(joined, first);
+    return first;
+  }
+
+  // `first_node` must be a first node
+  node last_same_node(const node& first_node) {
+    next(first_node);
+    return (*last_map)[first_node];
+  }
+
+  std::size_t size() const { return parent_map->size(); }
+
+  // O(n), only takes the pattern of `events`, which must outlive the graph
+  void build(const events_t<value_type>& events, monitor_context& ctx) {
+    this->events = &events;
+    this->ctx = &ctx;
+    parent_map->clear();
+    last_map->clear();
+    madj_list->clear();
+    pattern.assign(events.size() + 1, {});
+    invocations.assign(MAX_PROC_NUM, {});
+
+    uint32_t max_bit = 0;
+    for (std::size_t layer = 0; layer < events.size(); ++layer) {
+      auto [time, is_inv, optr] = events[layer];
+      pattern[layer].max_bit = max_bit;
+      bool ignore =
+          (sizeof...(methods) > 0) && ((optr->method != methods) && ...);
+      if (ignore) continue;
+
+      uint32_t opbit = 1 << optr->proc;
+      if (is_inv) {
+        pattern[layer].pending_bit = opbit;
+        invocations[optr->proc].push_back(layer);
+        max_bit |= opbit;
+      } else {
+        pattern[layer].critical_bit = opbit;
+        max_bit ^= opbit;
+      }
+    }
+    pattern[events.size()].max_bit = max_bit;
+  }
+
+ private:
+  // adds the edges of the nodes joined with `first` to `edges`, returning the
+  // last of them
+  node expand(const node& first, frontier_list_t& edges) {
+    operation_t<value_type>* ongoing[MAX_PROC_NUM];
+    uint32_t before[MAX_PROC_NUM];
+    int layer = first.layer;
+    uint32_t sub = first.bits;
+    for (uint32_t x = pattern[layer].max_bit; x; x &= x - 1) {
+      const auto& invoked = invocations[std::countr_zero(x)];
+      int at = *(std::lower_bound(invoked.begin(), invoked.end(), layer) - 1);
+      ongoing[std::countr_zero(x)] = std::get<2>((*events)[at]);
+    }
+
+    bool before_stale = true;
+    for (;;) {
+      ctx->step();
+      const bit_pattern& curr = pattern[layer];
+      if (uint32_t free = curr.max_bit & ~sub) {
+        if (before_stale) alike_before(curr.max_bit, ongoing, before);
+        before_stale = false;
+        for (uint32_t x = free; x; x &= (x - 1)) {
+          if (before[std::countr_zero(x)] & ~sub) continue;
+          edges.emplace_back(first_same_node({layer, sub | (x & -x)}),
+                             ongoing[std::countr_zero(x)]);
+        }
+      }
+
+      if (std::cmp_equal(layer, events->size()) ||
+          (curr.critical_bit && !(curr.critical_bit & sub)))
+        return {layer, sub};
+      if (curr.pending_bit) {
+        ongoing[std::countr_zero(curr.pending_bit)] =
+            std::get<2>((*events)[layer]);
+        before_stale = true;
+      }
+      before_stale |= curr.critical_bit != 0;
+      sub ^= curr.critical_bit;
+      ++layer;
+      parent_map->try_emplace({layer, sub}, first);
+    }
+  }
+
+  arena_held<node_map> parent_map;
+  arena_held<node_map> last_map;
+  arena_held<frontier_adj_list> madj_list;
+
+  // of each layer, and the layers of the invocations of each process
+  std::pmr::vector<bit_pattern> pattern;
+  std::pmr::vector<std::pmr::vector<int>> invocations;
+
+  const events_t<value_type>* events = nullptr;
+  monitor_context* ctx = nullptr;
+  std::vector<node> path;
 };
 
 }  // namespace fptlin
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "definitions.h"
+#include "history_writer.h"
+
+namespace fptlin {
+
+namespace generator {
+
+struct params {
+  std::size_t size = 100;  // number of operations
+  proc_type procs = 4;
+  // mean distance from an operation's linearization point to either end of
+  // its interval, in gaps between consecutive linearization points
+  double overlap = 1.0;
+  std::size_t values = 0;  // values are drawn from [0, values), 0 for unique
+  bool linearizable = true;
+  uint64_t seed = 1;
+};
+
+// gap between consecutive linearization points
+constexpr time_type GAP = 10;
+
+template <typename value_type>
+struct sequence_t : std::vector<std::pair<Method, value_type>> {
+  // an operation that `shape` makes respond before those after it are invoked
+  std::optional<std::size_t> detached;
+};
+
+struct value_source {
+  value_source(std::mt19937_64& rng, std::size_t range)
+      : rng(rng), range(range) {}
+
+  // a value, unique across calls if `range` is 0
+  default_value_type next() {
+    if (!range) return fresh();
+    return std::uniform_int_distribution<default_value_type>(
+        0, static_cast<default_value_type>(range) - 1)(rng);
+  }
+
+  // a value not returned by any call so far
+  default_value_type fresh() {
+    return static_cast<default_value_type>(range) + last++;
+  }
+
+  std::mt19937_64& rng;
+  std::size_t range;
+  default_value_type last = 0;
+};
+
+inline bool coin(std::mt19937_64& rng, double p) {
+  return std::bernoulli_distribution(p)(rng);
+}
+
+template <typename T>
+T& pick(std::mt19937_64& rng, std::vector<T>& v) {
+  return v[std::uniform_int_distribution<std::size_t>(0, v.size() - 1)(rng)];
+}
+
+/**
+ * Sequential operations of each data type, as legal executions of the
+ * sequential object, and a way to make each of them illegal under any
+ * reordering.
+ *
+ * An execution is made illegal by moving an operation that observes a value,
+ * e.g. a dequeue, right before the first operation putting the value, and
+ * detaching it, so that it must take effect before any of them. So every
+ * value observed is put, and the violation only shows in the order intervals
+ * impose. Executions without such an operation are made illegal otherwise.
+ */
+
+// of an operation, the value it puts or observes, if any
+using value_key = std::optional<default_value_type>;
+
+// moves an operation observing a value put by an earlier one, picked at random,
+// right before the first of these, and detaches it; returns whether any does
+template <typename value_type, typename puts_fn, typename observes_fn>
+bool hoist(std::mt19937_64& rng, sequence_t<value_type>& seq, puts_fn puts,
+           observes_fn observes) {
+  std::map<default_value_type, std::size_t> first;
+  std::vector<std::pair<std::size_t, std::size_t>> candidates;
+  for (std::size_t j = 0; j < seq.size(); ++j) {
+    if (value_key k = observes(seq[j]))
+      if (auto it = first.find(*k); it != first.end())
+        candidates.emplace_back(j, it->second);
+    if (value_key k = puts(seq[j])) first.emplace(*k, j);
+  }
+  if (candidates.empty()) return false;
+
+  auto [from, to] = pick(rng, candidates);
+  std::rotate(seq.begin() + to, seq.begin() + from, seq.begin() + from + 1);
+  seq.detached = to;
+  return true;
+}
+
+// stack, queue and priority queue share the shape of their executions
+template <typename container_t>
+sequence_t<default_value_type> container_sequence(std::mt19937_64& rng,
+                                                  const params& p, Method ins,
+                                                  Method rem) {
+  sequence_t<default_value_type> seq;
+  value_source values(rng, p.values);
+  container_t c;
+  for (std::size_t i = 0; i < p.size; ++i) {
+    if (c.empty() ? coin(rng, 0.8) : coin(rng, 0.45)) {
+      default_value_type v = values.next();
+      c.insert(v);
+      seq.emplace_back(ins, v);
+    } else if (coin(rng, 0.9)) {
+      seq.emplace_back(rem, c.empty() ? EMPTY_VALUE : c.top());
+      if (!c.empty()) c.remove();
+    } else {
+      seq.emplace_back(Method::PEEK, c.empty() ? EMPTY_VALUE : c.top());
+    }
+  }
+  return seq;
+}
+
+struct stack_container {
+  bool empty() const { return c.empty(); }
+  void insert(default_value_type v) { c.push_back(v); }
+  default_value_type top() const { return c.back(); }
+  void remove() { c.pop_back(); }
+  std::vector<default_value_type> c;
+};
+
+struct queue_container {
+  bool empty() const { return c.empty(); }
+  void insert(default_value_type v) { c.push_back(v); }
+  default_value_type top() const { return c.front(); }
+  void remove() { c.pop_front(); }
+  std::deque<default_value_type> c;
+};
+
+struct priorityqueue_container {
+  bool empty() const { return c.empty(); }
+  void insert(default_value_type v) { c.insert(v); }
+  default_value_type top() const { return *c.rbegin(); }
+  void remove() { c.erase(std::prev(c.end())); }
+  std::multiset<default_value_type> c;
+};
+
+// makes some removal or peek return a value before it is inserted, or one
+// that never is
+inline void violate_container(std::mt19937_64& rng,
+                              sequence_t<default_value_type>& seq,
+                              const params& p, Method ins) {
+  auto puts = [ins](const auto& o) {
+    return o.first == ins ? value_key(o.second) : std::nullopt;
+  };
+  auto observes = [ins](const auto& o) {
+    return o.first != ins && o.second != EMPTY_VALUE ? value_key(o.second)
+                                                     : std::nullopt;
+  };
+  if (hoist(rng, seq, puts, observes)) return;
+
+  auto fresh = static_cast<default_value_type>(p.values);
+  for (auto& [method, value] : seq)
+    if (method == ins) fresh = std::max(fresh, value + 1);
+
+  std::vector<std::size_t> observers;
+  for (std::size_t i = 0; i < seq.size(); ++i)
+    if (seq[i].first != ins) observers.push_back(i);
+  if (observers.empty())
+    seq.emplace_back(Method::PEEK, fresh);
+  else
+    seq[pick(rng, observers)].second = fresh;
+}
+
+inline sequence_t<default_value_type> sequence_stack(std::mt19937_64& rng,
+                                                     const params& p) {
+  auto seq = container_sequence<stack_container>(rng, p, Method::PUSH,
+                                                 Method::POP);
+  if (!p.linearizable) violate_container(rng, seq, p, Method::PUSH);
+  return seq;
+}
+
+inline sequence_t<default_value_type> sequence_queue(std::mt19937_64& rng,
+                                                     const params& p) {
+  auto seq = container_sequence<queue_container>(rng, p, Method::ENQ,
+                                                 Method::DEQ);
+  if (!p.linearizable) violate_container(rng, seq, p, Method::ENQ);
+  return seq;
+}
+
+inline sequence_t<default_value_type> sequence_priorityqueue(
+    std::mt19937_64& rng, const params& p) {
+  auto seq = container_sequence<priorityqueue_container>(
+      rng, p, Method::INSERT, Method::POLL);
+  if (!p.linearizable) violate_container(rng, seq, p, Method::INSERT);
+  return seq;
+}
+
+// a read-modify-write expecting a value before it is written, or one that
+// never is, is illegal
+inline sequence_t<std::tuple<default_value_type, default_value_type>>
+sequence_rmw(std::mt19937_64& rng, const params& p) {
+  sequence_t<std::tuple<default_value_type, default_value_type>> seq;
+  value_source values(rng, p.values);
+  default_value_type reg = 0;
+  for (std::size_t i = 0; i < p.size; ++i) {
+    default_value_type next = values.next();
+    seq.emplace_back(Method::READ_MODIFY_WRITE, std::tuple{reg, next});
+    reg = next;
+  }
+  if (p.linearizable || seq.empty()) return seq;
+  auto puts = [](const auto& o) { return value_key(std::get<1>(o.second)); };
+  // 0 is held initially
+  auto observes = [](const auto& o) {
+    auto v = std::get<0>(o.second);
+    return v ? value_key(v) : std::nullopt;
+  };
+  if (!hoist(rng, seq, puts, observes))
+    std::get<0>(pick(rng, seq).second) = values.fresh();
+  return seq;
+}
+
+// a read of a value before it is written, or of one that never is, is illegal
+inline sequence_t<default_value_type> sequence_rw_register(
+    std::mt19937_64& rng, const params& p) {
+  sequence_t<default_value_type> seq;
+  value_source values(rng, p.values);
+  // held initially, so not written when values are unique
+  if (!p.values) values.fresh();
+  default_value_type reg = 0;
+  for (std::size_t i = 0; i < p.size; ++i) {
+    if (coin(rng, 0.4)) {
+      reg = values.next();
+      seq.emplace_back(Method::WRITE, reg);
+    } else {
+      seq.emplace_back(Method::READ, reg);
+    }
+  }
+  if (p.linearizable) return seq;
+  auto puts = [](const auto& o) {
+    return o.first == Method::WRITE ? value_key(o.second) : std::nullopt;
+  };
+  auto observes = [](const auto& o) {
+    return o.first == Method::READ && o.second ? value_key(o.second)
+                                               : std::nullopt;
+  };
+  if (!hoist(rng, seq, puts, observes)) {
+    auto violation = std::pair{Method::READ, values.fresh()};
+    if (seq.empty())
+      seq.push_back(violation);
+    else
+      pick(rng, seq) = violation;
+  }
+  return seq;
+}
+
+// a successful decrement before any increment, or more successful decrements
+// than increments, are illegal
+inline sequence_t<bool> sequence_semaphore(std::mt19937_64& rng,
+                                           const params& p) {
+  sequence_t<bool> seq;
+  std::size_t cnt = 0;
+  for (std::size_t i = 0; i < p.size; ++i) {
+    if (coin(rng, 0.5)) {
+      ++cnt;
+      seq.emplace_back(Method::INCR, true);
+    } else {
+      seq.emplace_back(Method::DECR, cnt > 0);
+      if (cnt) --cnt;
+    }
+  }
+  if (p.linearizable) return seq;
+  auto puts = [](const auto& o) {
+    return o.first == Method::INCR ? value_key(0) : std::nullopt;
+  };
+  auto observes = [](const auto& o) {
+    return o.first == Method::DECR && o.second ? value_key(0) : std::nullopt;
+  };
+  if (!hoist(rng, seq, puts, observes)) {
+    std::vector<std::size_t> incrs;
+    for (std::size_t i = 0; i < seq.size(); ++i)
+      if (seq[i].first == Method::INCR) incrs.push_back(i);
+    std::shuffle(incrs.begin(), incrs.end(), rng);
+    // each conversion lowers the final count by 2
+    for (std::size_t i = 0; i <= cnt / 2; ++i) {
+      if (i < incrs.size())
+        seq[incrs[i]].first = Method::DECR;
+      else
+        seq.emplace_back(Method::DECR, true);
+    }
+  }
+  return seq;
+}
+
+// a value found before it is inserted, or one that never is, is illegal
+inline sequence_t<std::tuple<default_value_type, bool>> sequence_set(
+    std::mt19937_64& rng, const params& p) {
+  sequence_t<std::tuple<default_value_type, bool>> seq;
+  value_source values(rng, p.values);
+  std::vector<default_value_type> present;
+  std::set<default_value_type> contents;
+  auto existing = [&]() {
+    return present.empty() || coin(rng, 0.2) ? values.next()
+                                             : pick(rng, present);
+  };
+  for (std::size_t i = 0; i < p.size; ++i) {
+    double c = std::uniform_real_distribution<double>()(rng);
+    if (c < 0.4) {
+      default_value_type v = values.next();
+      bool added = contents.insert(v).second;
+      if (added) present.push_back(v);
+      seq.emplace_back(Method::INSERT, std::tuple{v, added});
+    } else if (c < 0.7) {
+      default_value_type v = existing();
+      bool removed = contents.erase(v);
+      if (removed) std::erase(present, v);
+      seq.emplace_back(Method::REMOVE, std::tuple{v, removed});
+    } else {
+      default_value_type v = existing();
+      seq.emplace_back(Method::CONTAINS, std::tuple{v, contents.count(v) > 0});
+    }
+  }
+  if (p.linearizable) return seq;
+  auto puts = [](const auto& o) {
+    auto [v, ok] = o.second;
+    return o.first == Method::INSERT && ok ? value_key(v) : std::nullopt;
+  };
+  auto observes = [](const auto& o) {
+    auto [v, ok] = o.second;
+    return o.first != Method::INSERT && ok ? value_key(v) : std::nullopt;
+  };
+  if (!hoist(rng, seq, puts, observes)) {
+    auto violation = std::tuple{values.fresh(), true};
+    if (seq.empty())
+      seq.emplace_back(Method::CONTAINS, violation);
+    else
+      pick(rng, seq) = {Method::CONTAINS, violation};
+  }
+  return seq;
+}
+
+/**
+ * Assigns each operation of `seq`, in order, to an idle process and an
+ * interval around its linearization point, `GAP` apart from the previous one.
+ * The intervals keep `seq` a valid linearization. Those after the detached
+ * operation, if any, are then delayed until it responds.
+ */
+template <typename value_type>
+history_t<value_type> shape(std::mt19937_64& rng, const params& p,
+                            const sequence_t<value_type>& seq) {
+  history_t<value_type> hist;
+  std::vector<time_type> idle_from(std::max<proc_type>(p.procs, 1), 0);
+  std::vector<proc_type> idle;
+  std::exponential_distribution<double> width(1.0 / std::max(p.overlap, 1e-9));
+
+  auto reach = [&]() { return 1 + time_type(width(rng) * GAP); };
+  time_type point = GAP;
+  for (auto& [method, value] : seq) {
+    // postponed until some process is idle
+    for (point += GAP;; point += GAP) {
+      idle.clear();
+      for (proc_type proc = 0; proc < idle_from.size(); ++proc)
+        if (idle_from[proc] + 1 < point) idle.push_back(proc);
+      if (!idle.empty()) break;
+    }
+
+    proc_type proc = pick(rng, idle);
+    time_type start =
+        std::max(idle_from[proc] + 1, point - std::min(reach(), point));
+    time_type end = point + reach();
+    idle_from[proc] = end;
+    hist.push_back({id_type(hist.size() + 1), proc, method, value, start, end});
+  }
+
+  if (seq.detached) {
+    std::size_t d = *seq.detached;
+    time_type first = MAX_TIME;
+    for (std::size_t i = d + 1; i < hist.size(); ++i)
+      first = std::min(first, hist[i].startTime);
+    if (first <= hist[d].endTime)
+      for (std::size_t i = d + 1; i < hist.size(); ++i) {
+        hist[i].startTime += hist[d].endTime + 1 - first;
+        hist[i].endTime += hist[d].endTime + 1 - first;
+      }
+  }
+  return hist;
+}
+
+}  // namespace generator
+
+}  // namespace fptlin
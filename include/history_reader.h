@@ -2,28 +2,75 @@
 
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "definitions.h"
 
 namespace fptlin {
 
+// the type of histories of several objects, each declared by a line
+// `# object <id> <type>` before the operations on it, which are prefixed by
+// its id
+inline constexpr std::string_view OBJECTS_TYPE = "objects";
+
+// an object of a history of `OBJECTS_TYPE`
+struct object_history {
+  std::string id;
+  std::string type;
+
+  // the lines of its operations without the id, as `read_hist` reads them
+  std::string ops;
+};
+
 struct history_reader {
  public:
   history_reader(const std::string& path) : path(path) {}
 
   template <typename... Args>
-  using pack_type = std::conditional_t<
-      (sizeof...(Args) == 1),
-      typename std::tuple_element<0, std::tuple<Args...>>::type,
-      std::tuple<Args...>>;
+  history_t<pack_type<Args...>> get_hist() {
+    return get_hist<Args...>(0, nullptr);
+  }
 
+  // the operations from byte `from` on, with the offset past the line of each
+  // in `ends`, in which case a last line without a newline is still being
+  // written and is left out
   template <typename... Args>
-  history_t<pack_type<Args...>> get_hist() {
+  history_t<pack_type<Args...>> get_hist(std::streamoff from,
+                                         std::vector<std::streamoff>* ends) {
+    std::ifstream f(path);
+    f.seekg(from);
+    return read_hist<Args...>(f, ends);
+  }
+
+  // of a history of `OBJECTS_TYPE`
+  std::vector<object_history> get_objects() {
     std::ifstream f(path);
     std::string line;
+    std::getline(f, line);
+    return read_objects(f);
+  }
+
+  std::string get_type_s() {
+    std::ifstream f(path);
+    std::string line;
+    if (!std::getline(f, line)) return "";
+    return read_type(line);
+  }
+
+  // as `get_hist`, from a stream positioned past the type, e.g. of a history
+  // held in memory
+  template <typename... Args>
+  static history_t<pack_type<Args...>> read_hist(
+      std::istream& in, std::vector<std::streamoff>* ends = nullptr) {
+    std::string line;
     history_t<pack_type<Args...>> hist;
     id_type id = 0;
-    while (std::getline(f, line)) {
+    while (std::getline(in, line)) {
+      if (ends && in.eof()) break;
       if (line.empty() || line[0] == '#') continue;
 
       std::stringstream ss{line};
@@ -41,14 +88,49 @@ struct history_reader {
 
       hist.emplace_back(++id, proc, stomethod(methodStr), value, startTime,
                         endTime);
+      if (ends) ends->push_back(in.tellg());
     }
     return hist;
   }
 
-  std::string get_type_s() {
-    std::ifstream f(path);
+  // as `get_objects`, from a stream positioned past the type, in order of
+  // declaration, reading each line once
+  static std::vector<object_history> read_objects(std::istream& in) {
+    std::vector<object_history> objects;
+    std::unordered_map<std::string, std::size_t> index;
     std::string line;
-    if (!std::getline(f, line) || line.empty() || line[0] != '#') return "";
+    while (std::getline(in, line)) {
+      std::stringstream ss{line};
+      std::string id;
+      if (!(ss >> id)) continue;
+
+      if (id[0] == '#') {
+        std::string keyword;
+        object_history o;
+        if (id != "#" || !(ss >> keyword) || keyword != "object") continue;
+        if (!(ss >> o.id >> o.type))
+          throw std::invalid_argument("Incomplete declaration '" + line + "'");
+        if (!index.emplace(o.id, objects.size()).second)
+          throw std::invalid_argument("Object '" + o.id +
+                                      "' is declared twice");
+        objects.push_back(std::move(o));
+        continue;
+      }
+
+      auto it = index.find(id);
+      if (it == index.end())
+        throw std::invalid_argument("Undeclared object '" + id + "'");
+      std::streamoff rest = ss.tellg();
+      std::string& ops = objects[it->second].ops;
+      if (rest >= 0) ops.append(line, rest);
+      ops += '\n';
+    }
+    return objects;
+  }
+
+  // the type named by the first line of a history, empty if none
+  static std::string read_type(const std::string& line) {
+    if (line.empty() || line[0] != '#') return "";
 
     std::string_view sv{line};
     sv.remove_prefix(1);
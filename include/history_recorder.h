@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(FPTLIN_RECORDER_TSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define FPTLIN_RECORDER_USE_TSC
+#endif
+
+#include "definitions.h"
+#include "history_writer.h"
+
+namespace fptlin {
+
+/**
+ * Records a history of operations performed by concurrent threads on a single
+ * object, with as little interference with their interleaving as possible.
+ *
+ * Each process owns a preallocated single-producer ring buffer, so recording
+ * an operation takes two timestamps and one release store, without locks,
+ * allocation or formatting. A process must only be driven by one thread at a
+ * time, as processes of a history are sequential anyway.
+ *
+ * Timestamps are read from `steady_clock`, or from the time stamp counter on
+ * x86 when built with `FPTLIN_RECORDER_TSC`, which is cheaper but only
+ * comparable across cores on processors with an invariant TSC.
+ */
+template <typename value_type>
+struct history_recorder {
+  // an operation that has been invoked but has not responded yet
+  struct pending {
+    proc_type proc;
+    time_type startTime;
+  };
+
+  history_recorder(proc_type procs, std::size_t capacity)
+      : capacity(std::bit_ceil(std::max<std::size_t>(capacity, 1))),
+        buffers(procs) {
+    if (procs == 0 || procs > MAX_PROC_NUM)
+      throw std::invalid_argument("Process count must be within [1, " +
+                                  std::to_string(MAX_PROC_NUM) + "]");
+    for (auto& buffer : buffers)
+      buffer.slots = std::make_unique<slot[]>(this->capacity);
+  }
+
+  history_recorder(const history_recorder&) = delete;
+  history_recorder& operator=(const history_recorder&) = delete;
+
+  static time_type timestamp() {
+#ifdef FPTLIN_RECORDER_USE_TSC
+    // keeps the read from drifting into or out of the operation
+    _mm_lfence();
+    time_type t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  // to be called right before `proc` starts an operation
+  pending invoke(proc_type proc) { return {proc, timestamp()}; }
+
+  // to be called right after the operation started by `op` returns
+  void respond(const pending& op, Method method, const value_type& value) {
+    time_type endTime = timestamp();
+    buffer& b = buffers[op.proc];
+    std::size_t head = b.head.load(std::memory_order_relaxed);
+    if (head - b.tail.load(std::memory_order_acquire) == capacity) {
+      b.dropped.store(true, std::memory_order_relaxed);
+      return;
+    }
+    b.slots[head & (capacity - 1)] = {method, value, op.startTime, endTime};
+    b.head.store(head + 1, std::memory_order_release);
+  }
+
+  /**
+   * Moves operations that have responded out of the ring buffers, making room
+   * for more. May run while processes are recording, but not concurrently with
+   * itself or `flush`.
+   */
+  void drain() {
+    for (proc_type proc = 0; proc < buffers.size(); ++proc) {
+      buffer& b = buffers[proc];
+      std::size_t tail = b.tail.load(std::memory_order_relaxed);
+      std::size_t head = b.head.load(std::memory_order_acquire);
+      for (; tail != head; ++tail) {
+        slot& s = b.slots[tail & (capacity - 1)];
+        drained.push_back({0, proc, s.method, s.value, s.startTime, s.endTime});
+      }
+      b.tail.store(tail, std::memory_order_release);
+    }
+  }
+
+  /**
+   * Returns every operation recorded since the last flush, ordered by
+   * invocation. Operations still pending are left out.
+   *
+   * Throws `std::overflow_error` if a buffer was full when a process
+   * responded, as a history missing operations cannot be checked.
+   */
+  history_t<value_type> flush() {
+    drain();
+    for (auto& b : buffers)
+      if (b.dropped.exchange(false, std::memory_order_relaxed)) {
+        drained.clear();
+        throw std::overflow_error(
+            "Recorder buffer overflowed, drain more often or raise capacity");
+      }
+
+    history_t<value_type> hist = std::move(drained);
+    drained.clear();
+    std::stable_sort(hist.begin(), hist.end(), [](auto& a, auto& b) {
+      return a.startTime < b.startTime;
+    });
+    for (std::size_t i = 0; i < hist.size(); ++i) hist[i].id = i + 1;
+    return hist;
+  }
+
+  // flushes in the format read by `history_reader`
+  void flush(std::ostream& os, const std::string& type) {
+    write_history(os, type, flush());
+  }
+
+ private:
+  struct slot {
+    Method method;
+    value_type value;
+    time_type startTime;
+    time_type endTime;
+  };
+
+  // keeps indices written by different threads on separate cache lines
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  // indices only grow, wrapping around `slots`
+  struct alignas(CACHE_LINE) buffer {
+    std::atomic<std::size_t> head{0};  // written by the process
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};  // written by `drain`
+    std::atomic<bool> dropped{false};
+    std::unique_ptr<slot[]> slots;
+  };
+
+  const std::size_t capacity;
+  std::vector<buffer> buffers;
+  history_t<value_type> drained;
+};
+
+}  // namespace fptlin
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+#include "definitions.h"
+
+namespace fptlin {
+
+template <typename value_type>
+void write_value(std::ostream& os, const value_type& value) {
+  os << value;
+}
+
+template <typename... Args>
+void write_value(std::ostream& os, const std::tuple<Args...>& value) {
+  std::apply(
+      [&os](const Args&... args) {
+        std::size_t i = 0;
+        ((os << (i++ ? " " : "") << args), ...);
+      },
+      value);
+}
+
+// a line per operation, each after `prefix`, e.g. the id of the object of a
+// history of several
+template <typename value_type>
+void write_operations(std::ostream& os, const history_t<value_type>& hist,
+                      std::string_view prefix = {}) {
+  for (auto& o : hist) {
+    os << prefix << o.proc << " " << o.startTime << " " << o.endTime << " "
+       << methodtos(o.method) << " ";
+    write_value(os, o.value);
+    os << "\n";
+  }
+}
+
+// in the format read by `history_reader`
+template <typename value_type>
+void write_history(std::ostream& os, const std::string& type,
+                   const history_t<value_type>& hist) {
+  os << "# " << type << "\n";
+  write_operations(os, hist);
+}
+
+}  // namespace fptlin
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "checker.h"
+#include "definitions.h"
+#include "monitor_context.h"
+#include "thread_pool.h"
+
+namespace fptlin {
+
+// whether operations of `method` put their value into an object
+inline bool puts_value(Method method) {
+  return method == PUSH || method == ENQ || method == INSERT ||
+         method == WRITE;
+}
+
+// whether operations of `method` put their value into an object, or take it
+// out, so that dropping one alone changes what the others of the value see
+inline bool moves_value(Method method) {
+  return puts_value(method) || method == POP || method == DEQ ||
+         method == POLL || method == REMOVE;
+}
+
+/**
+ * Shrinks a history that is not linearizable to a core that is not either, by
+ * delta debugging (Zeller & Hildebrandt, TSE 2002): groups of operations are
+ * dropped for as long as what is left is still found not linearizable. The
+ * groups are first the processes, then the operations on each value, and last
+ * windows of operations in order of invocation, which narrow down to single
+ * operations, so that no operation of the core can be dropped alone.
+ *
+ * A core must fail as the history does, and not for want of operations
+ * dropped: a pop is not left without its push, nor a push without its pop.
+ * So each operation that takes a value out is tied to one that puts it, and
+ * the two are dropped together, and each other operation of a value, e.g. a
+ * read, to one that puts it and that it may see, and is dropped with it. No
+ * such tie is known between the operations of `rmw` and `semaphore`, whose
+ * cores may fail for a reason of their own.
+ *
+ * The candidates of a round are checked at once on a pool of threads. The
+ * first of them not linearizable, with smaller ones first, is kept, so that
+ * the core does not depend on the order checks end in, and once one is found
+ * the checks of those after it are stopped. A candidate left undecided by
+ * `limits` counts as linearizable.
+ */
+template <typename value_type>
+class minimizer {
+ public:
+  using span_t = std::span<const operation_t<value_type>>;
+
+  // made from the threads of the pool at once, e.g. each with a
+  // `thread_local` checker
+  using check_t = std::function<check_result(span_t, const monitor_limits&)>;
+
+  // `threads` of 0 for one per hardware thread; `limits` apply to each check
+  minimizer(check_t check, const monitor_limits& limits,
+            std::size_t threads = 0)
+      : check(std::move(check)), limits(limits), pool(threads) {}
+
+  // the core of `hist`, its operations in their order, or none unless `hist`
+  // itself is found not linearizable, as `result` tells
+  history_t<value_type> minimize(const history_t<value_type>& hist) {
+    ops = &hist;
+    checks = 0;
+    tie(hist);
+
+    {
+      std::exception_ptr error;
+      std::latch done(1);
+      pool.submit([&] {
+        try {
+          result = check(hist, limits);
+        } catch (const std::exception&) {
+          error = std::current_exception();
+        }
+        done.count_down();
+      });
+      done.wait();
+      ++checks;
+      if (error) std::rethrow_exception(error);
+    }
+    if (!result.decided || result.linearizable) return {};
+
+    std::vector<std::size_t> core(hist.size());
+    std::iota(core.begin(), core.end(), 0);
+    core = reduce(group(core, [](auto& o) { return o.proc; }));
+    core = reduce(group(core, [](auto& o) { return o.value; }));
+    std::ranges::sort(core, [&hist](std::size_t a, std::size_t b) {
+      return std::pair{hist[a].startTime, hist[a].endTime} <
+             std::pair{hist[b].startTime, hist[b].endTime};
+    });
+    core = reduce(group(core, [](auto& o) { return o.id; }));
+
+    std::ranges::sort(core);
+    history_t<value_type> res;
+    res.reserve(core.size());
+    for (std::size_t i : core) res.push_back(hist[i]);
+    return res;
+  }
+
+  // of the history given to the last `minimize`
+  check_result result{false, false, Engine::GREEDY, {}, {}};
+
+  // made by the last `minimize`, including those stopped
+  std::size_t checks = 0;
+
+ private:
+  // indices of operations of `ops`
+  using group_t = std::vector<std::size_t>;
+
+  // `core` grouped by `key`, in order of the first operation of each group
+  template <typename key_fn>
+  std::vector<group_t> group(const std::vector<std::size_t>& core,
+                             key_fn key) {
+    using key_t = std::decay_t<std::invoke_result_t<
+        key_fn, const operation_t<value_type>&>>;
+    std::map<key_t, std::size_t> index;
+    std::vector<group_t> groups;
+    for (std::size_t i : core) {
+      auto [it, added] = index.emplace(key((*ops)[i]), groups.size());
+      if (added) groups.emplace_back();
+      groups[it->second].push_back(i);
+    }
+    return groups;
+  }
+
+  // the operations of as few of `groups` as are found not linearizable, all
+  // of which are; the groups are split into `n` runs, and each run is tried
+  // alone, then all but each run, with `n` doubled while none is
+  std::vector<std::size_t> reduce(std::vector<group_t> groups) {
+    std::size_t n = 2;
+    while (groups.size() >= 2) {
+      n = std::min(n, groups.size());
+
+      // run `r` is groups `[bound(r), bound(r + 1))`
+      auto bound = [&](std::size_t r) { return r * groups.size() / n; };
+      auto append = [&](group_t& to, std::size_t from, std::size_t end) {
+        for (std::size_t g = bound(from); g < bound(end); ++g)
+          to.insert(to.end(), groups[g].begin(), groups[g].end());
+      };
+      // with two runs, each alone is all but the other
+      std::size_t alone = n > 2 ? n : 0;
+      auto candidate = [&](std::size_t c) {
+        group_t picked;
+        if (c < alone) {
+          append(picked, c, c + 1);
+        } else {
+          append(picked, 0, c - alone);
+          append(picked, c - alone + 1, n);
+        }
+        return close(std::move(picked));
+      };
+
+      std::size_t c = first_failing(alone + n, candidate);
+      if (c < alone + n) {
+        std::vector<bool> kept(ops->size());
+        for (std::size_t i : candidate(c)) kept[i] = true;
+        for (group_t& g : groups)
+          std::erase_if(g, [&kept](std::size_t i) { return !kept[i]; });
+        std::erase_if(groups, [](const group_t& g) { return g.empty(); });
+        n = c < alone ? 2 : std::max<std::size_t>(n - 1, 2);
+      } else if (n < groups.size()) {
+        n = std::min(2 * n, groups.size());
+      } else {
+        break;
+      }
+    }
+
+    group_t core;
+    for (const group_t& g : groups) core.insert(core.end(), g.begin(), g.end());
+    return core;
+  }
+
+  // ties each operation that takes a value out, in order of response, to an
+  // operation left that puts the value and is invoked before it responds, the
+  // last for a stack or set and the first otherwise, and each other operation
+  // of a value to the last that puts it, is invoked before it responds and is
+  // not taken out before it is invoked
+  void tie(const history_t<value_type>& hist) {
+    value_of.resize(hist.size());
+    tied_to.assign(hist.size(), NONE);
+    std::map<value_type, std::size_t> values;
+    std::vector<std::size_t> puts, takes, others;
+    for (std::size_t i = 0; i < hist.size(); ++i) {
+      auto [it, added] = values.emplace(hist[i].value, values.size());
+      value_of[i] = it->second;
+      if (puts_value(hist[i].method))
+        puts.push_back(i);
+      else if (moves_value(hist[i].method))
+        takes.push_back(i);
+      else
+        others.push_back(i);
+    }
+    std::ranges::sort(puts, {}, [&](std::size_t i) {
+      return std::pair{hist[i].startTime, i};
+    });
+    std::ranges::sort(takes, {}, [&](std::size_t i) {
+      return std::pair{hist[i].endTime, i};
+    });
+
+    // of each value, its puts invoked so far and not tied
+    std::vector<std::deque<std::size_t>> left(values.size());
+    auto p = puts.begin();
+    for (std::size_t t : takes) {
+      for (; p != puts.end() && hist[*p].startTime < hist[t].endTime; ++p)
+        left[value_of[*p]].push_back(*p);
+      std::deque<std::size_t>& of_value = left[value_of[t]];
+      if (of_value.empty()) continue;
+      bool last = hist[t].method == POP || hist[t].method == REMOVE;
+      std::size_t q = last ? of_value.back() : of_value.front();
+      if (last)
+        of_value.pop_back();
+      else
+        of_value.pop_front();
+      tied_to[t] = q;
+      tied_to[q] = t;
+    }
+
+    std::vector<std::vector<std::size_t>> invoked(values.size());
+    for (std::size_t q : puts) invoked[value_of[q]].push_back(q);
+    for (std::size_t i : others) {
+      const std::vector<std::size_t>& of_value = invoked[value_of[i]];
+      auto q = std::ranges::lower_bound(
+          of_value, hist[i].endTime, {},
+          [&](std::size_t j) { return hist[j].startTime; });
+      while (q != of_value.begin()) {
+        std::size_t t = tied_to[*--q];
+        if (t == NONE || hist[t].endTime >= hist[i].startTime) {
+          tied_to[i] = *q;
+          break;
+        }
+      }
+    }
+  }
+
+  // `candidate` without the operations tied to one it drops
+  group_t close(group_t candidate) {
+    std::vector<bool> kept(ops->size());
+    for (std::size_t i : candidate) kept[i] = true;
+    // puts and takes first, as others depend on them alone
+    for (std::size_t i : candidate)
+      if (moves_value((*ops)[i].method) && tied_to[i] != NONE &&
+          !kept[tied_to[i]])
+        kept[i] = false;
+    std::erase_if(candidate, [&](std::size_t i) {
+      return !kept[i] || (tied_to[i] != NONE && !kept[tied_to[i]]);
+    });
+    return candidate;
+  }
+
+  // the first of `count` candidates found not linearizable, `count` if none,
+  // with `candidate(c)` the operations of the c-th
+  template <typename candidate_fn>
+  std::size_t first_failing(std::size_t count, candidate_fn candidate) {
+    std::unique_ptr<std::atomic<bool>[]> stop(new std::atomic<bool>[count]{});
+    std::atomic<std::size_t> first = count;
+    std::atomic<std::size_t> started = 0;
+    std::latch done(count);
+
+    for (std::size_t c = 0; c < count; ++c) {
+      pool.submit([&, c] {
+        if (c < first) {
+          ++started;
+          history_t<value_type> hist;
+          for (std::size_t i : candidate(c)) hist.push_back((*ops)[i]);
+          monitor_limits candidate_limits = limits;
+          candidate_limits.stop = &stop[c];
+
+          bool failing = false;
+          try {
+            check_result r = check(hist, candidate_limits);
+            failing = r.decided && !r.linearizable;
+          } catch (const std::exception&) {
+            // not a history the check takes, so not a core
+          }
+          if (failing) {
+            std::size_t f = first;
+            while (c < f && !first.compare_exchange_weak(f, c)) {
+            }
+            // those after `f` are stopped already
+            for (std::size_t later = c + 1; later < f; ++later)
+              stop[later] = true;
+          }
+        }
+        done.count_down();
+      });
+    }
+    done.wait();
+    checks += started;
+    return first;
+  }
+
+  check_t check;
+  monitor_limits limits;
+  thread_pool pool;
+
+  const history_t<value_type>* ops = nullptr;
+
+  static constexpr std::size_t NONE = -1;
+
+  // of each operation of `ops`, an index of its value, and the operation it
+  // is tied to by `tie`, if any
+  std::vector<std::size_t> value_of, tied_to;
+};
+
+}  // namespace fptlin
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "checkpoint.h"
+#include "definitions.h"
+#include "stats.h"
+
+namespace fptlin {
+
+/**
+ * Resources a single check may use, 0 for unbounded.
+ */
+struct monitor_limits {
+  // bytes of the set of visited nodes kept by searches, beyond which nodes are
+  // evicted and may be explored again
+  std::size_t mem_limit = 0;
+
+  // wall time of the check
+  std::chrono::nanoseconds timeout{0};
+
+  // steps, see `monitor_context::step`
+  uint64_t max_nodes = 0;
+
+  // ends the check as if a budget ran out once set, e.g. from a signal handler
+  const std::atomic<bool>* stop = nullptr;
+};
+
+/**
+ * Where and how often engines save a `checkpoint` of their state. Only the
+ * aadt search and the CFG DP take checkpoints.
+ */
+struct checkpoint_options {
+  // none are taken if empty
+  std::string path;
+
+  std::chrono::nanoseconds interval = std::chrono::seconds(60);
+
+  // recorded as `checkpoint::source`
+  std::string source;
+};
+
+/**
+ * Which exact engine decides what the cheap ones leave open: the FPT engine of
+ * the data type, `jit`, or, for `AUTO`, the one a cost model expects to be
+ * faster. For `RACE`, a `checker` runs both at once and cancels the other once
+ * one decides.
+ */
+enum class Strategy { AUTO, FPT, JIT, RACE };
+
+// as given to --engine
+inline Strategy stostrategy(const std::string& str) {
+  if (str == "auto") return Strategy::AUTO;
+  if (str == "fpt") return Strategy::FPT;
+  if (str == "jit") return Strategy::JIT;
+  if (str == "race") return Strategy::RACE;
+  throw std::invalid_argument("Unknown engine '" + str + "'");
+}
+
+inline std::string strategytos(Strategy strategy) {
+  switch (strategy) {
+    case Strategy::AUTO:
+      return "auto";
+    case Strategy::FPT:
+      return "fpt";
+    case Strategy::JIT:
+      return "jit";
+    case Strategy::RACE:
+      return "race";
+  }
+  throw std::invalid_argument("Unknown strategy");
+}
+
+/**
+ * How far the exact engines got, reported when a check runs out of budget.
+ */
+struct monitor_progress {
+  // nodes of graphs built or searched and DP entries computed
+  uint64_t nodes = 0;
+
+  // deepest layer, i.e. number of events, reached by a graph build or search
+  // out of `layers`
+  std::size_t layer = 0;
+  std::size_t layers = 0;
+
+  // DP entries computed out of `dp_entries`
+  std::size_t dp_done = 0;
+  std::size_t dp_entries = 0;
+};
+
+// thrown by `monitor_context::step` once a budget of `monitor_limits` is spent
+struct budget_exhausted : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * State shared between the caller and the engines for a single check.
+ */
+struct monitor_context {
+  using clock = std::chrono::steady_clock;
+
+  // engine that decided the result
+  Engine engine = Engine::GREEDY;
+
+  monitor_limits limits;
+  monitor_progress progress;
+
+  // never `RACE`
+  Strategy strategy = Strategy::AUTO;
+
+  // ends the check as `limits.stop` does, set by whoever runs it, e.g. once
+  // another engine decided the same history
+  const std::atomic<bool>* cancel = nullptr;
+
+  // of the graphs, tables and sets that engines grow during the check, which
+  // may never free them, e.g. an `arena`
+  std::pmr::memory_resource* memory = std::pmr::new_delete_resource();
+
+  checkpoint_options checkpoints;
+
+  // state to continue from, used by the engine that took it
+  std::optional<checkpoint> resume;
+
+  monitor_stats stats;
+
+  // starts the clocks of `limits.timeout` and `checkpoints.interval`
+  void start() {
+    clock::time_point now = clock::now();
+    if (limits.timeout.count()) deadline = now + limits.timeout;
+    if (!checkpoints.path.empty()) next_checkpoint = now + checkpoints.interval;
+  }
+
+  // to be called by engines per unit of work, throws `budget_exhausted` once a
+  // budget is spent; the clock is only read every `CLOCK_PERIOD` steps
+  void step() {
+    ++progress.nodes;
+    if (limits.max_nodes && progress.nodes > limits.max_nodes)
+      throw budget_exhausted("Node budget exhausted");
+    if (progress.nodes % CLOCK_PERIOD) return;
+
+    if ((limits.stop && limits.stop->load(std::memory_order_relaxed)) ||
+        (cancel && cancel->load(std::memory_order_relaxed)))
+      throw budget_exhausted("Stopped");
+    if (deadline == NEVER && next_checkpoint == NEVER) return;
+    clock::time_point now = clock::now();
+    if (now >= deadline) throw budget_exhausted("Time budget exhausted");
+    if (now >= next_checkpoint) checkpoint_due = true;
+  }
+
+  void reach(std::size_t layer) {
+    progress.layer = std::max(progress.layer, layer);
+  }
+
+  /**
+   * Checkpoints are only taken at points where the state of the engine is
+   * consistent: whenever `checkpoint_due` is set, and when `step` throws.
+   */
+  bool checkpointing() const { return !checkpoints.path.empty(); }
+  bool checkpoint_due = false;
+
+  void save_checkpoint(Engine engine, uint64_t fingerprint, std::string state) {
+    checkpoint{checkpoints.source, engine, fingerprint, std::move(state)}.save(
+        checkpoints.path);
+    checkpoint_due = false;
+    next_checkpoint = clock::now() + checkpoints.interval;
+  }
+
+  // the state of `resume` if taken by `engine`, which must have been given the
+  // same history
+  std::optional<std::string> take_resume(Engine engine, uint64_t fingerprint) {
+    if (!resume || resume->engine != engine) return std::nullopt;
+    if (resume->fingerprint != fingerprint)
+      throw std::invalid_argument("Checkpoint is of another history");
+    std::string state = std::move(resume->state);
+    resume.reset();
+    return state;
+  }
+
+ private:
+  static constexpr uint64_t CLOCK_PERIOD = 1024;
+  static constexpr clock::time_point NEVER = clock::time_point::max();
+
+  clock::time_point deadline = NEVER;
+  clock::time_point next_checkpoint = NEVER;
+};
+
+}  // namespace fptlin
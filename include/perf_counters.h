@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fptlin {
+
+#define FPTLIN_HW_EVENT_EXPAND(MACRO) \
+  MACRO(CYCLES)                       \
+  MACRO(INSTRUCTIONS)                 \
+  MACRO(LLC_MISSES)                   \
+  MACRO(BRANCH_MISSES)
+
+enum class HwEvent {
+#define FPTLIN_HW_EVENT_LIST(ENUM) ENUM,
+  FPTLIN_HW_EVENT_EXPAND(FPTLIN_HW_EVENT_LIST)
+#undef FPTLIN_HW_EVENT_LIST
+};
+
+#define FPTLIN_HW_EVENT_ONE(ENUM) +1
+constexpr std::size_t HW_EVENT_NUM = 0 FPTLIN_HW_EVENT_EXPAND(
+    FPTLIN_HW_EVENT_ONE);
+#undef FPTLIN_HW_EVENT_ONE
+
+inline std::string hweventtos(const HwEvent& event) {
+#define FPTLIN_HW_EVENTSTR_TRANSLATE(ENUM) \
+  case HwEvent::ENUM:                      \
+    return #ENUM;
+  switch (event) {
+    FPTLIN_HW_EVENT_EXPAND(FPTLIN_HW_EVENTSTR_TRANSLATE)
+    default:
+      throw std::invalid_argument("Unknown hardware event: " +
+                                  std::to_string(std::to_underlying(event)));
+  }
+#undef FPTLIN_HW_EVENTSTR_TRANSLATE
+}
+
+/**
+ * Hardware counters of the calling thread, read through `perf_event_open`.
+ *
+ * Events that cannot be opened, e.g. inside containers, under a restrictive
+ * `perf_event_paranoid` or on other platforms, are unavailable and read as 0.
+ */
+struct perf_counters {
+  using values_t = std::array<uint64_t, HW_EVENT_NUM>;
+
+  perf_counters() {
+    fds.fill(-1);
+#ifdef __linux__
+    constexpr std::array<uint64_t, HW_EVENT_NUM> configs{
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (std::size_t i = 0; i < HW_EVENT_NUM; ++i) {
+      perf_event_attr attr{};
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+  }
+
+  perf_counters(const perf_counters&) = delete;
+  perf_counters& operator=(const perf_counters&) = delete;
+
+  ~perf_counters() {
+#ifdef __linux__
+    for (int fd : fds)
+      if (fd >= 0) close(fd);
+#endif
+  }
+
+  bool available(HwEvent event) const {
+    return fds[std::to_underlying(event)] >= 0;
+  }
+
+  bool available() const {
+    for (int fd : fds)
+      if (fd >= 0) return true;
+    return false;
+  }
+
+  values_t read_all() const {
+    values_t values{};
+#ifdef __linux__
+    for (std::size_t i = 0; i < HW_EVENT_NUM; ++i)
+      if (fds[i] < 0 || read(fds[i], &values[i], sizeof(uint64_t)) !=
+                            sizeof(uint64_t))
+        values[i] = 0;
+#endif
+    return values;
+  }
+
+ private:
+  std::array<int, HW_EVENT_NUM> fds;
+};
+
+}  // namespace fptlin
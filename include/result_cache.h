@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+#include "checker.h"
+#include "checkpoint.h"
+#include "definitions.h"
+
+namespace fptlin {
+
+/**
+ * `hist` with its times replaced by their ranks among all times, processes
+ * renumbered in order of their first operation, and operations sorted, so that
+ * histories that only differ in these have the same canonical form. Both keep
+ * every comparison of times, and so the result.
+ *
+ * Identical operations of different processes are ordered by the original
+ * process ids, so some equivalent histories still differ.
+ */
+template <typename value_type>
+history_t<value_type> canonical(std::span<const operation_t<value_type>> hist) {
+  std::vector<time_type> times;
+  times.reserve(2 * hist.size());
+  for (auto& o : hist) {
+    times.push_back(o.startTime);
+    times.push_back(o.endTime);
+  }
+  std::ranges::sort(times);
+  times.erase(std::unique(times.begin(), times.end()), times.end());
+  auto rank = [&times](time_type t) {
+    return time_type(std::ranges::lower_bound(times, t) - times.begin());
+  };
+
+  history_t<value_type> canon(hist.begin(), hist.end());
+  for (auto& o : canon) {
+    o.startTime = rank(o.startTime);
+    o.endTime = rank(o.endTime);
+  }
+  auto order = [](const operation_t<value_type>& a,
+                  const operation_t<value_type>& b) {
+    return std::tie(a.startTime, a.endTime, a.method, a.value, a.proc) <
+           std::tie(b.startTime, b.endTime, b.method, b.value, b.proc);
+  };
+  std::ranges::sort(canon, order);
+
+  std::unordered_map<proc_type, proc_type> procs;
+  for (auto& o : canon)
+    o.proc = procs.try_emplace(o.proc, procs.size()).first->second;
+  std::ranges::sort(canon, order);
+  for (std::size_t i = 0; i < canon.size(); ++i) canon[i].id = id_type(i + 1);
+  return canon;
+}
+
+/**
+ * Results of earlier checks in a directory, one file per history, so that a
+ * history checked before is not checked again. Histories are looked up by
+ * their `canonical` form. Results of engines of another `ENGINE_VERSION` are
+ * ignored, and results left undecided by a budget are never stored.
+ *
+ * Files are replaced atomically, so that processes may share a directory.
+ */
+class result_cache {
+ public:
+  struct key_t {
+    std::string type;
+    std::size_t size;
+
+    // of the canonical form, the first naming the file and the second checked
+    // against its contents
+    uint64_t hash;
+    uint64_t check;
+  };
+
+  struct entry {
+    check_result result;
+
+    // taken by the check
+    std::chrono::nanoseconds time;
+  };
+
+  static constexpr std::string_view MAGIC = "FPTLINRC";
+  static constexpr uint32_t VERSION = 2;
+
+  explicit result_cache(std::filesystem::path dir) : dir(std::move(dir)) {
+    std::filesystem::create_directories(this->dir);
+  }
+
+  template <typename value_type>
+  static key_t key(const std::string& type,
+                   std::span<const operation_t<value_type>> hist) {
+    history_t<value_type> canon = canonical(hist);
+    return {type, hist.size(), fingerprint(canon, fnv1a(type)),
+            fingerprint(canon, fnv1a(type + '\n'))};
+  }
+
+  // the result of `check()` for the history of `key`, timed, unless one is
+  // stored, with whether it was; a result that cannot be stored is still
+  // returned
+  template <typename check_t>
+  std::pair<entry, bool> get_or_check(const key_t& key, check_t check) const {
+    if (std::optional<entry> e = find(key)) return {*e, true};
+    auto start = std::chrono::steady_clock::now();
+    entry e{check(), {}};
+    e.time = std::chrono::steady_clock::now() - start;
+    try {
+      store(key, e);
+    } catch (const std::exception&) {
+    }
+    return {e, false};
+  }
+
+  // nothing if missing, of another version or unreadable
+  std::optional<entry> find(const key_t& key) const {
+    std::ifstream f(path(key), std::ios::binary);
+    if (!f) return std::nullopt;
+    std::string data{std::istreambuf_iterator<char>(f), {}};
+    if (!data.starts_with(MAGIC)) return std::nullopt;
+
+    try {
+      checkpoint_reader r(std::string_view(data).substr(MAGIC.size()));
+      if (r.get<uint32_t>() != VERSION ||
+          r.get<uint32_t>() != ENGINE_VERSION ||
+          r.get<std::string>() != key.type ||
+          r.get<std::size_t>() != key.size || r.get<uint64_t>() != key.check)
+        return std::nullopt;
+
+      entry e{};
+      e.result.decided = true;
+      e.result.linearizable = r.get<bool>();
+      e.result.engine = r.get<Engine>();
+      e.time = std::chrono::nanoseconds(r.get<int64_t>());
+      monitor_progress& p = e.result.progress;
+      std::tie(p.nodes, p.layer, p.layers, p.dp_done, p.dp_entries) =
+          r.get<std::tuple<uint64_t, std::size_t, std::size_t, std::size_t,
+                           std::size_t>>();
+      // stats are dropped by builds without them
+      if (r.get<bool>() && monitor_stats::enabled) {
+#ifdef FPTLIN_STATS
+        for (auto& phase : e.result.stats.phases)
+          phase = std::chrono::nanoseconds(r.get<int64_t>());
+        for (auto& counter : e.result.stats.counters)
+          counter = r.get<uint64_t>();
+#endif
+      }
+      return e;
+    } catch (const std::invalid_argument&) {
+      return std::nullopt;
+    }
+  }
+
+  // throws `std::runtime_error` if the file cannot be written
+  void store(const key_t& key, const entry& e) const {
+    if (!e.result.decided) return;
+    checkpoint_writer w;
+    w.put(VERSION);
+    w.put(ENGINE_VERSION);
+    w.put(key.type);
+    w.put(key.size);
+    w.put(key.check);
+    w.put(e.result.linearizable);
+    w.put(e.result.engine);
+    w.put(int64_t(e.time.count()));
+    const monitor_progress& p = e.result.progress;
+    w.put(std::tie(p.nodes, p.layer, p.layers, p.dp_done, p.dp_entries));
+    w.put(monitor_stats::enabled);
+#ifdef FPTLIN_STATS
+    for (auto& phase : e.result.stats.phases) w.put(int64_t(phase.count()));
+    for (auto& counter : e.result.stats.counters) w.put(counter);
+#endif
+    replace_file(path(key), std::string(MAGIC) + w.data);
+  }
+
+ private:
+  std::string path(const key_t& key) const {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(key.hash));
+    return dir / name;
+  }
+
+  std::filesystem::path dir;
+};
+
+}  // namespace fptlin
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "perf_counters.h"
+
+namespace fptlin {
+
+#define FPTLIN_PHASE_EXPAND(MACRO) \
+  MACRO(PARSE)                     \
+  MACRO(GREEDY)                    \
+  MACRO(DISTINCT)                  \
+  MACRO(SORT)                      \
+  MACRO(GRAPH_BUILD)               \
+  MACRO(ENTRY_ORDER)               \
+  MACRO(DP)                        \
+  MACRO(SEARCH)
+
+#define FPTLIN_COUNTER_EXPAND(MACRO) \
+  MACRO(NODES_VISITED)               \
+  MACRO(NODES_EVICTED)               \
+  MACRO(GRAPH_NODES)                 \
+  MACRO(DP_ENTRIES)                  \
+  MACRO(DP_PRUNED)                   \
+  MACRO(MATRIX_CELLS)                \
+  MACRO(PEAK_RSS_KB)
+
+enum class Phase {
+#define FPTLIN_PHASE_LIST(ENUM) ENUM,
+  FPTLIN_PHASE_EXPAND(FPTLIN_PHASE_LIST)
+#undef FPTLIN_PHASE_LIST
+};
+
+enum class Counter {
+#define FPTLIN_COUNTER_LIST(ENUM) ENUM,
+  FPTLIN_COUNTER_EXPAND(FPTLIN_COUNTER_LIST)
+#undef FPTLIN_COUNTER_LIST
+};
+
+#define FPTLIN_STATS_ONE(ENUM) +1
+constexpr std::size_t PHASE_NUM = 0 FPTLIN_PHASE_EXPAND(FPTLIN_STATS_ONE);
+constexpr std::size_t COUNTER_NUM = 0 FPTLIN_COUNTER_EXPAND(FPTLIN_STATS_ONE);
+#undef FPTLIN_STATS_ONE
+
+inline std::string phasetos(const Phase& phase) {
+#define FPTLIN_PHASESTR_TRANSLATE(ENUM) \
+  case Phase::ENUM:                     \
+    return #ENUM;
+  switch (phase) {
+    FPTLIN_PHASE_EXPAND(FPTLIN_PHASESTR_TRANSLATE)
+    default:
+      throw std::invalid_argument("Unknown phase: " +
+                                  std::to_string(std::to_underlying(phase)));
+  }
+#undef FPTLIN_PHASESTR_TRANSLATE
+}
+
+inline std::string countertos(const Counter& counter) {
+#define FPTLIN_COUNTERSTR_TRANSLATE(ENUM) \
+  case Counter::ENUM:                     \
+    return #ENUM;
+  switch (counter) {
+    FPTLIN_COUNTER_EXPAND(FPTLIN_COUNTERSTR_TRANSLATE)
+    default:
+      throw std::invalid_argument("Unknown counter: " +
+                                  std::to_string(std::to_underlying(counter)));
+  }
+#undef FPTLIN_COUNTERSTR_TRANSLATE
+}
+
+/**
+ * Time spent per phase and engine counters for a single check.
+ *
+ * Only collected when built with `FPTLIN_STATS`, otherwise every member
+ * function is a no-op and the whole surface compiles away.
+ */
+struct monitor_stats {
+#ifdef FPTLIN_STATS
+  static constexpr bool enabled = true;
+
+  void add(Counter counter, uint64_t n) {
+    counters[std::to_underlying(counter)] += n;
+  }
+  void set_max(Counter counter, uint64_t n) {
+    uint64_t& count = counters[std::to_underlying(counter)];
+    count = std::max(count, n);
+  }
+
+  // sums phases and counters, e.g. to account for work outside of a check
+  monitor_stats& operator+=(const monitor_stats& other) {
+    for (std::size_t i = 0; i < PHASE_NUM; ++i) {
+      phases[i] += other.phases[i];
+      for (std::size_t e = 0; e < HW_EVENT_NUM; ++e)
+        hw_counters[i][e] += other.hw_counters[i][e];
+    }
+    for (std::size_t i = 0; i < COUNTER_NUM; ++i)
+      counters[i] += other.counters[i];
+    return *this;
+  }
+
+  std::array<std::chrono::nanoseconds, PHASE_NUM> phases{};
+  std::array<uint64_t, COUNTER_NUM> counters{};
+
+  // hardware counters per phase, only read when `perf` is set
+  perf_counters* perf = nullptr;
+  std::array<perf_counters::values_t, PHASE_NUM> hw_counters{};
+#else
+  static constexpr bool enabled = false;
+
+  void add(Counter, uint64_t) {}
+  void set_max(Counter, uint64_t) {}
+  monitor_stats& operator+=(const monitor_stats&) { return *this; }
+#endif
+};
+
+/**
+ * Adds the lifetime of this object to a phase of `stats`.
+ */
+struct scoped_phase {
+#ifdef FPTLIN_STATS
+  using clock = std::chrono::steady_clock;
+
+  scoped_phase(monitor_stats& stats, Phase phase)
+      : stats(stats), phase(phase) {
+    if (stats.perf) hw_start = stats.perf->read_all();
+    start = clock::now();
+  }
+
+  ~scoped_phase() {
+    auto i = std::to_underlying(phase);
+    stats.phases[i] += clock::now() - start;
+    if (!stats.perf) return;
+    perf_counters::values_t hw_end = stats.perf->read_all();
+    for (std::size_t e = 0; e < HW_EVENT_NUM; ++e)
+      stats.hw_counters[i][e] += hw_end[e] - hw_start[e];
+  }
+
+ private:
+  monitor_stats& stats;
+  Phase phase;
+  clock::time_point start;
+  perf_counters::values_t hw_start;
+#else
+  scoped_phase(monitor_stats&, Phase) {}
+#endif
+};
+
+// writes `"phases":{...},"counters":{...}` with lower-cased names as keys,
+// phases in seconds, followed by `"hw_counters":{<phase>:{...},...}` if
+// hardware counters were requested; unavailable ones are `null`
+inline void write_json(std::ostream& os, const monitor_stats& stats) {
+  auto key = [&os](std::string name) {
+    for (char& c : name) c = std::tolower(c);
+    os << '"' << name << "\":";
+  };
+
+  os << "\"phases\":{";
+#ifdef FPTLIN_STATS
+  for (std::size_t i = 0; i < PHASE_NUM; ++i) {
+    if (i) os << ',';
+    key(phasetos(static_cast<Phase>(i)));
+    os << std::chrono::duration<double>(stats.phases[i]).count();
+  }
+#endif
+  os << "},\"counters\":{";
+#ifdef FPTLIN_STATS
+  for (std::size_t i = 0; i < COUNTER_NUM; ++i) {
+    if (i) os << ',';
+    key(countertos(static_cast<Counter>(i)));
+    os << stats.counters[i];
+  }
+  os << '}';
+
+  if (!stats.perf) return;
+  os << ",\"hw_counters\":{";
+  for (std::size_t i = 0; i < PHASE_NUM; ++i) {
+    if (i) os << ',';
+    key(phasetos(static_cast<Phase>(i)));
+    os << '{';
+    for (std::size_t e = 0; e < HW_EVENT_NUM; ++e) {
+      if (e) os << ',';
+      auto event = static_cast<HwEvent>(e);
+      key(hweventtos(event));
+      if (stats.perf->available(event))
+        os << stats.hw_counters[i][e];
+      else
+        os << "null";
+    }
+    os << '}';
+  }
+  os << '}';
+#else
+  (void)key;
+  (void)stats;
+  os << '}';
+#endif
+}
+
+}  // namespace fptlin
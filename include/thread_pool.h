@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fptlin {
+
+/**
+ * Fixed set of threads running submitted tasks in submission order. Threads
+ * are kept between tasks, and so is anything they keep in `thread_local`
+ * storage, e.g. a `checker` with its buffers.
+ */
+class thread_pool {
+ public:
+  // `threads` of 0 for one per hardware thread
+  explicit thread_pool(std::size_t threads = 0) {
+    if (!threads) threads = std::max(std::thread::hardware_concurrency(), 1U);
+    workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i)
+      workers.emplace_back([this] { work(); });
+  }
+
+  // runs the tasks still queued first
+  ~thread_pool() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    ready.notify_all();
+    for (std::thread& t : workers) t.join();
+  }
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  void submit(std::function<void()> task) {
+    {
+      std::lock_guard lock(mutex);
+      tasks.push_back(std::move(task));
+    }
+    ready.notify_one();
+  }
+
+  std::size_t size() const { return workers.size(); }
+
+ private:
+  void work() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock(mutex);
+        ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<std::function<void()>> tasks;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+};
+
+}  // namespace fptlin
@@ -0,0 +1,226 @@
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "checker.h"
+#include "history_generator.h"
+
+using namespace fptlin;
+
+typedef std::chrono::steady_clock hr_clock;
+
+// outcome of a check, written by the child through a pipe
+struct run_result {
+  bool rejected;  // e.g. of more processes than the engine takes
+  bool result;
+  Engine engine;
+  double seconds;
+};
+
+template <typename T>
+std::vector<T> parse_list(const std::string& arg) {
+  std::vector<T> list;
+  std::stringstream ss{arg};
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    std::stringstream is{item};
+    T value;
+    if (!(is >> value))
+      throw std::invalid_argument("Bad list item '" + item + "'");
+    list.push_back(value);
+  }
+  return list;
+}
+
+run_result check(const std::string& type, const generator::params& p,
+                 Strategy strategy) {
+  std::mt19937_64 rng(p.seed);
+  checker hist_checker;
+  hist_checker.strategy = strategy;
+
+#define FPTLIN_ADT_CHECK(ADT, ...)                                      \
+  if (type == #ADT) {                                                   \
+    auto seq = generator::sequence_##ADT(rng, p);                       \
+    auto hist = generator::shape(rng, p, seq);                          \
+    auto start = hr_clock::now();                                       \
+    try {                                                               \
+      check_result result = hist_checker.check_##ADT(hist);             \
+      std::chrono::duration<double> time = hr_clock::now() - start;     \
+      return {false, result.linearizable, result.engine, time.count()}; \
+    } catch (const std::invalid_argument&) {                            \
+      return {true, false, Engine::GREEDY, 0};                          \
+    }                                                                   \
+  }
+  FPTLIN_ADT_EXPAND(FPTLIN_ADT_CHECK)
+#undef FPTLIN_ADT_CHECK
+
+  throw std::invalid_argument("Unknown data type '" + type + "'");
+}
+
+/**
+ * Runs a single check in a child process, so that its peak resident set can
+ * be measured on its own and a timed out or crashed check does not end the
+ * sweep.
+ */
+void run(const std::string& type, const generator::params& p,
+         Strategy strategy, unsigned timeout) {
+  std::cout << type << "," << p.size << "," << p.procs << "," << p.overlap
+            << "," << p.values << "," << p.linearizable << "," << p.seed
+            << "," << strategytos(strategy) << ",";
+  std::cout.flush();
+
+  int fds[2];
+  if (pipe(fds) != 0) throw std::runtime_error("Failed to create a pipe");
+  pid_t pid = fork();
+  if (pid < 0) throw std::runtime_error("Failed to fork");
+  if (pid == 0) {
+    close(fds[0]);
+    alarm(timeout);
+    run_result r = check(type, p, strategy);
+    _exit(write(fds[1], &r, sizeof(r)) == sizeof(r) ? EXIT_SUCCESS
+                                                    : EXIT_FAILURE);
+  }
+
+  close(fds[1]);
+  run_result r;
+  bool received = read(fds[0], &r, sizeof(r)) == sizeof(r);
+  close(fds[0]);
+  int status;
+  rusage usage{};
+  wait4(pid, &status, 0, &usage);
+
+  if (received && !r.rejected)
+    std::cout << r.result << "," << enginetos(r.engine) << "," << r.seconds;
+  else
+    std::cout << ",,";
+  std::cout << "," << usage.ru_maxrss << ",";
+  if (received)
+    std::cout << (r.rejected ? "rejected" : "ok");
+  else if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM)
+    std::cout << "timeout";
+  else
+    std::cout << "crash";
+  std::cout << std::endl;
+}
+
+void print_usage() {
+  std::cout << "Usage: ./fptlin_bench [-a types] [-n sizes] [-k procs] "
+               "[-o overlaps] [-v values] [-e engines] [-r reps] [-s seed] "
+               "[-T timeout]\n"
+            << "Options take comma-separated lists, every combination of "
+               "which is run:\n"
+            << "  -a\tdata types (default all)\n"
+            << "  -n\tnumbers of operations (default 100,1000,10000)\n"
+            << "  -k\tnumbers of processes (default 2,4,8)\n"
+            << "  -o\toverlaps, see fptlin_gen (default 1)\n"
+            << "  -v\tvalue ranges, 0 for unique values (default 0)\n"
+            << "  -e\tengines, as --engine of fptlin (default auto,fpt,jit)\n"
+            << "  -r\thistories per combination and outcome (default 1)\n"
+            << "  -s\tseed of the first history (default 1)\n"
+            << "  -T\tseconds before a check is abandoned (default 60)\n";
+}
+
+int main(int argc, char* argv[]) {
+  const std::vector<std::string> all_types{
+#define FPTLIN_ADT_NAME(ADT, ...) #ADT,
+      FPTLIN_ADT_EXPAND(FPTLIN_ADT_NAME)
+#undef FPTLIN_ADT_NAME
+  };
+  std::vector<std::string> types = all_types;
+  std::vector<std::size_t> sizes{100, 1000, 10000};
+  std::vector<proc_type> procs{2, 4, 8};
+  std::vector<double> overlaps{1.0};
+  std::vector<std::size_t> values{0};
+  std::vector<Strategy> strategies{Strategy::AUTO, Strategy::FPT,
+                                   Strategy::JIT};
+  unsigned reps = 1;
+  uint64_t seed = 1;
+  unsigned timeout = 60;
+
+  int flag;
+  int long_optind;
+  static struct option long_options[] = {{"help", no_argument, 0, 0},
+                                         {0, 0, 0, 0}};
+  while ((flag = getopt_long(argc, argv, "a:n:k:o:v:e:r:s:T:", long_options,
+                             &long_optind)) != -1)
+    switch (flag) {
+      case 0:
+        print_usage();
+        exit(EXIT_SUCCESS);
+      case 'a':
+        types = parse_list<std::string>(optarg);
+        break;
+      case 'n':
+        sizes = parse_list<std::size_t>(optarg);
+        break;
+      case 'k':
+        procs = parse_list<proc_type>(optarg);
+        break;
+      case 'o':
+        overlaps = parse_list<double>(optarg);
+        break;
+      case 'v':
+        values = parse_list<std::size_t>(optarg);
+        break;
+      case 'e':
+        strategies.clear();
+        try {
+          for (auto& name : parse_list<std::string>(optarg))
+            strategies.push_back(stostrategy(name));
+        } catch (const std::invalid_argument& e) {
+          std::cerr << e.what() << ".\n";
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'r':
+        reps = std::stoul(optarg);
+        break;
+      case 's':
+        seed = std::stoull(optarg);
+        break;
+      case 'T':
+        timeout = std::stoul(optarg);
+        break;
+      case '?':
+        std::cerr << "Unknown option `" << optopt << "'.\n";
+        exit(EXIT_FAILURE);
+      default:
+        abort();
+    }
+  for (auto& type : types)
+    if (std::find(all_types.begin(), all_types.end(), type) ==
+        all_types.end()) {
+      std::cerr << "Unknown data type '" << type << "'.\n";
+      exit(EXIT_FAILURE);
+    }
+  for (proc_type k : procs)
+    if (k == 0) {
+      std::cerr << "Process count must be positive.\n";
+      exit(EXIT_FAILURE);
+    }
+
+  std::cout << "type,size,procs,overlap,values,linearizable,seed,strategy,"
+               "result,engine,time_taken,peak_rss_kb,status"
+            << std::endl;
+  generator::params p;
+  for (auto& type : types)
+    for (std::size_t n : sizes)
+      for (proc_type k : procs)
+        for (double o : overlaps)
+          for (std::size_t v : values)
+            for (bool lin : {true, false})
+              for (unsigned r = 0; r < reps; ++r)
+                for (Strategy strategy : strategies) {
+                  p = {n, k, o, v, lin, seed + r};
+                  run(type, p, strategy, timeout);
+                }
+  return 0;
+}
@@ -0,0 +1,219 @@
+#include "checker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "algo/algos.h"
+
+namespace fptlin {
+
+namespace {
+
+// copies `hist` into `buffer` and checks it within `limits`, consuming
+// `resume`, until done or `cancel` is set
+template <typename value_type, typename check_t>
+check_result run(history_t<value_type>& buffer,
+                 std::span<const operation_t<value_type>> hist,
+                 const monitor_limits& limits,
+                 const checkpoint_options& checkpoints,
+                 std::optional<checkpoint>& resume, Strategy strategy,
+                 const std::atomic<bool>* cancel, arena& memory,
+                 [[maybe_unused]] perf_counters* perf, check_t check) {
+  buffer.assign(hist.begin(), hist.end());
+  monitor_context ctx;
+  ctx.limits = limits;
+  ctx.strategy = strategy;
+  ctx.cancel = cancel;
+  ctx.memory = &memory;
+  ctx.checkpoints = checkpoints;
+  ctx.resume = std::exchange(resume, std::nullopt);
+#ifdef FPTLIN_STATS
+  ctx.stats.perf = perf;
+#endif
+  ctx.start();
+
+  check_result result{false, true, Engine::GREEDY, {}, {}};
+  try {
+    result.linearizable = check(buffer, ctx);
+  } catch (const budget_exhausted&) {
+    result.decided = false;
+  }
+  memory.reset();
+  result.engine = ctx.engine;
+  result.progress = ctx.progress;
+  result.stats = ctx.stats;
+  return result;
+}
+
+// as `run` with `Strategy::FPT` on the calling thread and `Strategy::JIT` on
+// `racer` at once, each cancelling the other once decided; the result is that
+// of the first to decide, or of the FPT engines if neither does, or of the
+// search alone if the FPT engines reject the history; checks that checkpoint
+// or resume are left to the FPT engines, which alone take checkpoints
+template <typename value_type, typename check_t>
+check_result race(history_t<value_type>& buffer,
+                  std::span<const operation_t<value_type>> hist,
+                  const monitor_limits& limits,
+                  const checkpoint_options& checkpoints,
+                  std::optional<checkpoint>& resume, arena& memory,
+                  perf_counters* perf, std::unique_ptr<thread_pool>& racer,
+                  arena& race_memory, check_t check) {
+  if (!checkpoints.path.empty() || resume)
+    return run(buffer, hist, limits, checkpoints, resume, Strategy::FPT,
+               nullptr, memory, perf, check);
+  if (!racer) racer = std::make_unique<thread_pool>(1);
+
+  std::atomic<bool> decided = false;
+  std::atomic<int> first = -1;
+  auto finish = [&](int side, const check_result& result) {
+    if (!result.decided) return;
+    int none = -1;
+    first.compare_exchange_strong(none, side);
+    decided = true;
+  };
+
+  std::promise<check_result> jit_result;
+  racer->submit([&] {
+    try {
+      history_t<value_type> copy;
+      std::optional<checkpoint> no_resume;
+      check_result result = run(copy, hist, limits, {}, no_resume,
+                                Strategy::JIT, &decided, race_memory, nullptr,
+                                check);
+      finish(1, result);
+      jit_result.set_value(std::move(result));
+    } catch (...) {
+      decided = true;
+      jit_result.set_exception(std::current_exception());
+    }
+  });
+
+  check_result fpt;
+  try {
+    fpt = run(buffer, hist, limits, checkpoints, resume, Strategy::FPT,
+              &decided, memory, perf, check);
+  } catch (const std::invalid_argument&) {
+    // a history the FPT engines do not take, e.g. of too many processes, is
+    // left to the search
+    check_result jit = jit_result.get_future().get();
+    if (!jit.decided) throw;
+    return jit;
+  } catch (...) {
+    decided = true;
+    jit_result.get_future().wait();
+    throw;
+  }
+  finish(0, fpt);
+  check_result jit = jit_result.get_future().get();
+  return first == 1 ? jit : fpt;
+}
+
+// as `run`, from and to `state`
+template <typename model_t, typename value_type, typename check_t>
+check_result run_incremental(history_t<value_type>& buffer,
+                             std::span<const operation_t<value_type>> hist,
+                             incremental_state& state,
+                             const monitor_limits& limits, Strategy strategy,
+                             arena& memory,
+                             [[maybe_unused]] perf_counters* perf,
+                             check_t check) {
+  if (state.ops)
+    for (const auto& o : hist)
+      if (o.startTime <= state.last_end)
+        throw overlapping_operation("Operation overlaps those checked");
+  state.advanced = 0;
+
+  monitor_context ctx;
+  ctx.limits = limits;
+  ctx.strategy = strategy == Strategy::RACE ? Strategy::AUTO : strategy;
+  ctx.memory = &memory;
+#ifdef FPTLIN_STATS
+  ctx.stats.perf = perf;
+#endif
+  ctx.start();
+
+  check_result result{false, true, Engine::GREEDY, {}, {}};
+  if (!state.linearizable) return result;
+
+  // the last quiescent point, other than the end, as operations still running
+  // when `hist` was taken may have started before it
+  std::vector<time_type> min_start(hist.size() + 1, MAX_TIME);
+  for (std::size_t i = hist.size(); i--;)
+    min_start[i] = std::min(min_start[i + 1], hist[i].startTime);
+  std::size_t cut = 0;
+  time_type max_end = 0, cut_end = 0;
+  for (std::size_t i = 1; i < hist.size(); ++i) {
+    max_end = std::max(max_end, hist[i - 1].endTime);
+    if (max_end < min_start[i]) {
+      cut = i;
+      cut_end = max_end;
+    }
+  }
+
+  model_t model;
+  if (state.ops) {
+    checkpoint_reader r(state.model);
+    model.load(r);
+  }
+  try {
+    // a linearization orders the operations before the cut first, and the
+    // state after them does not depend on their order
+    if (cut) {
+      buffer.assign(hist.begin(), hist.begin() + cut);
+      state.linearizable = check(buffer, ctx, model);
+      state.ops += cut;
+      state.last_end = cut_end;
+      state.advanced = cut;
+      checkpoint_writer w;
+      if (state.linearizable) model.save(w);
+      state.model = std::move(w.data);
+    }
+    if (state.linearizable) {
+      buffer.assign(hist.begin() + cut, hist.end());
+      result.linearizable = check(buffer, ctx, model);
+    }
+  } catch (const budget_exhausted&) {
+    result.decided = false;
+  }
+  memory.reset();
+  result.engine = ctx.engine;
+  result.progress = ctx.progress;
+  result.stats = ctx.stats;
+  return result;
+}
+
+}  // namespace
+
+#define FPTLIN_CHECKER_DEFINE(ADT, ...)                                    \
+  check_result checker::check_##ADT(                                       \
+      std::span<const operation_t<pack_type<__VA_ARGS__>>> hist) {         \
+    auto check = [](auto& buffer, monitor_context& ctx) {                  \
+      return ADT::is_linearizable(buffer, ctx);                            \
+    };                                                                     \
+    if (strategy == Strategy::RACE)                                        \
+      return race(ADT##_buffer, hist, limits, checkpoints, resume, memory, \
+                  perf, racer, race_memory, check);                        \
+    return run(ADT##_buffer, hist, limits, checkpoints, resume, strategy,  \
+               nullptr, memory, perf, check);                              \
+  }
+FPTLIN_ADT_EXPAND(FPTLIN_CHECKER_DEFINE)
+#undef FPTLIN_CHECKER_DEFINE
+
+#define FPTLIN_CHECKER_DEFINE_INCREMENTAL(ADT, ...)                \
+  check_result checker::check_##ADT(                               \
+      std::span<const operation_t<pack_type<__VA_ARGS__>>> hist,   \
+      incremental_state& state) {                                  \
+    return run_incremental<ADT::model_t<pack_type<__VA_ARGS__>>>(  \
+        ADT##_buffer, hist, state, limits, strategy, memory, perf, \
+        [](auto& buffer, monitor_context& ctx, auto& model) {      \
+          return ADT::is_linearizable(buffer, ctx, model);         \
+        });                                                        \
+  }
+FPTLIN_AADT_EXPAND(FPTLIN_CHECKER_DEFINE_INCREMENTAL)
+#undef FPTLIN_CHECKER_DEFINE_INCREMENTAL
+
+}  // namespace fptlin
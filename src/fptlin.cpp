@@ -1,42 +1,92 @@
 #include <getopt.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <csignal>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
 
-#include "algo/algos.h"
+#include "checker.h"
 #include "history_reader.h"
+#include "history_writer.h"
+#include "minimizer.h"
+#include "result_cache.h"
+#include "serve.h"
+#include "thread_pool.h"
 
 using namespace fptlin;
 
 typedef std::chrono::steady_clock hr_clock;
-typedef int default_value_type;
+
+// exit status when a budget runs out before the result is known
+constexpr int EXIT_UNDECIDED = 2;
 
 hr_clock::time_point start, end;
-bool result;
+check_result result;
+monitor_stats parse_stats;
 std::string hist_type;
 size_t hist_size;
 
-#define FPTLIN_ADT_EXPAND(VARIADIC_MACRO)                     \
-  VARIADIC_MACRO(stack, default_value_type)                   \
-  VARIADIC_MACRO(queue, default_value_type)                   \
-  VARIADIC_MACRO(priorityqueue, default_value_type)           \
-  VARIADIC_MACRO(rmw, default_value_type, default_value_type) \
-  VARIADIC_MACRO(semaphore, bool)                             \
-  VARIADIC_MACRO(set, default_value_type, bool)
+// set by --cache, and whether the result was found in it
+std::optional<result_cache> cache;
+bool cached = false;
+
+// set on SIGINT or SIGTERM while checkpointing, so that the check saves its
+// state and stops
+std::atomic<bool> stop_requested;
+static_assert(std::atomic<bool>::is_always_lock_free);
+
+void request_stop(int) { stop_requested = true; }
+
+// of each object of a history of `OBJECTS_TYPE`, in order of declaration
+struct object_result {
+  std::string id;
+  check_result result{false, false, Engine::GREEDY, {}, {}};
+  std::size_t size = 0;
+  std::chrono::nanoseconds time{};
+  bool cached = false;
 
-void monitor(const std::string& input_file) {
+  // of a history that could not be read
+  std::exception_ptr error;
+};
+std::vector<object_result> objects;
+
+void monitor(checker& hist_checker, const std::string& input_file) {
   history_reader reader(input_file);
   hist_type = reader.get_type_s();
 
-#define FPTLIN_ADT_SWITCH(ADT, ...)             \
-  if (hist_type == #ADT) {                      \
-    auto hist = reader.get_hist<__VA_ARGS__>(); \
-    hist_size = hist.size();                    \
-    start = hr_clock::now();                    \
-    result = ADT::is_linearizable(hist);        \
-    end = hr_clock::now();                      \
-    return;                                     \
+#define FPTLIN_ADT_SWITCH(ADT, ...)                                      \
+  if (hist_type == #ADT) {                                               \
+    history_t<pack_type<__VA_ARGS__>> hist;                              \
+    {                                                                    \
+      scoped_phase phase(parse_stats, Phase::PARSE);                     \
+      hist = reader.get_hist<__VA_ARGS__>();                             \
+    }                                                                    \
+    hist_size = hist.size();                                             \
+    if (cache) {                                                         \
+      auto [e, hit] = cache->get_or_check(                               \
+          result_cache::key<pack_type<__VA_ARGS__>>(hist_type, hist),    \
+          [&] { return hist_checker.check_##ADT(hist); });               \
+      result = e.result;                                                 \
+      cached = hit;                                                      \
+      end = start + std::chrono::duration_cast<hr_clock::duration>(      \
+                        e.time);                                         \
+    } else {                                                             \
+      start = hr_clock::now();                                           \
+      result = hist_checker.check_##ADT(hist);                           \
+      end = hr_clock::now();                                             \
+    }                                                                    \
+    result.stats += parse_stats;                                         \
+    return;                                                              \
   }
   FPTLIN_ADT_EXPAND(FPTLIN_ADT_SWITCH)
 #undef FPTLIN_ADT_SWITCH
@@ -44,21 +94,433 @@ void monitor(const std::string& input_file) {
   throw std::invalid_argument("Unknown data type '" + hist_type + "'");
 }
 
-#undef FPTLIN_ADT_EXPAND
+// checks `o` with the `checker` of the calling thread, which keeps its buffers
+// across objects, unless found in `cache`
+void check_object(const object_history& o, object_result& r,
+                  const monitor_limits& limits, Strategy strategy) {
+  thread_local checker hist_checker;
+  hist_checker.limits = limits;
+  hist_checker.strategy = strategy;
+
+  std::istringstream in(o.ops);
+  monitor_stats parse;
+#define FPTLIN_ADT_SWITCH(ADT, ...)                                        \
+  if (o.type == #ADT) {                                                    \
+    history_t<pack_type<__VA_ARGS__>> hist;                                \
+    {                                                                      \
+      scoped_phase phase(parse, Phase::PARSE);                             \
+      hist = history_reader::read_hist<__VA_ARGS__>(in);                   \
+    }                                                                      \
+    r.size = hist.size();                                                  \
+    auto check = [&] { return hist_checker.check_##ADT(hist); };           \
+    if (cache) {                                                           \
+      auto [e, hit] = cache->get_or_check(                                 \
+          result_cache::key<pack_type<__VA_ARGS__>>(o.type, hist), check); \
+      r.result = e.result;                                                 \
+      r.time = e.time;                                                     \
+      r.cached = hit;                                                      \
+    } else {                                                               \
+      hr_clock::time_point begin = hr_clock::now();                        \
+      r.result = check();                                                  \
+      r.time = hr_clock::now() - begin;                                    \
+    }                                                                      \
+    r.result.stats += parse;                                               \
+    return;                                                                \
+  }
+  FPTLIN_ADT_EXPAND(FPTLIN_ADT_SWITCH)
+#undef FPTLIN_ADT_SWITCH
+
+  throw std::invalid_argument("Unknown data type '" + o.type +
+                              "' of object '" + o.id + "'");
+}
+
+/**
+ * Checks the objects of a history of `OBJECTS_TYPE` on `jobs` threads at once,
+ * as a history is linearizable iff the history of each object is. Once one is
+ * not, the others are stopped if `fail_fast`, and left undecided.
+ */
+void monitor_objects(const std::string& input_file, monitor_limits limits,
+                     Strategy strategy, std::size_t jobs, bool fail_fast) {
+  history_reader reader(input_file);
+  hist_type = OBJECTS_TYPE;
+  std::vector<object_history> histories;
+  {
+    scoped_phase phase(parse_stats, Phase::PARSE);
+    histories = reader.get_objects();
+  }
+  objects.resize(histories.size());
+
+  std::atomic<bool> failed = false;
+  if (fail_fast) limits.stop = &failed;
+  start = hr_clock::now();
+  {
+    thread_pool pool(std::min(jobs ? jobs : std::thread::hardware_concurrency(),
+                              std::max<std::size_t>(histories.size(), 1)));
+    for (std::size_t i = 0; i < histories.size(); ++i) {
+      pool.submit([&, i] {
+        object_result& r = objects[i];
+        r.id = histories[i].id;
+        if (failed) return;
+        try {
+          check_object(histories[i], r, limits, strategy);
+        } catch (const std::exception&) {
+          r.error = std::current_exception();
+        }
+        if (fail_fast && r.result.decided && !r.result.linearizable)
+          failed = true;
+      });
+    }
+  }
+  end = hr_clock::now();
+
+  result = {true, true, Engine::GREEDY, {}, parse_stats};
+  hist_size = 0;
+  for (const object_result& r : objects) {
+    if (r.error) std::rethrow_exception(r.error);
+    hist_size += r.size;
+    result.stats += r.result.stats;
+    if (!r.result.decided)
+      result.decided = false;
+    else if (!r.result.linearizable)
+      result.linearizable = false;
+  }
+  // one object that is not settles it
+  if (!result.linearizable) result.decided = true;
+}
+
+// of the core written by --minimize, and the checks taken to find it
+std::size_t core_size;
+std::size_t minimize_checks;
+
+/**
+ * Writes a core of the history in `input_file` that is not linearizable, as
+ * found by `minimizer` on `jobs` threads, to `output_file`, or stdout if empty,
+ * in the format of the history. Of a history of several objects, the objects
+ * are checked first, and the core is of the first found not linearizable.
+ * Nothing is written unless `result` is decided and not linearizable.
+ */
+void minimize(const std::string& input_file, const std::string& output_file,
+              const monitor_limits& limits, Strategy strategy,
+              std::size_t jobs) {
+  history_reader reader(input_file);
+  hist_type = reader.get_type_s();
+
+  // of the history, or of the object, minimized
+  std::string type = hist_type;
+  std::ifstream file(input_file);
+  std::istringstream text;
+  std::istream* in = &file;
+  std::ostringstream header;
+  std::string prefix;
+  if (hist_type == OBJECTS_TYPE) {
+    monitor_objects(input_file, limits, strategy, jobs, true);
+    auto failed = std::ranges::find_if(objects, [](const object_result& r) {
+      return r.result.decided && !r.result.linearizable;
+    });
+    if (failed == objects.end()) return;
+
+    std::vector<object_history> histories = reader.get_objects();
+    const object_history& o = histories[failed - objects.begin()];
+    type = o.type;
+    text.str(o.ops);
+    in = &text;
+    header << "# " << OBJECTS_TYPE << "\n# object " << o.id << " " << o.type
+           << "\n";
+    prefix = o.id + " ";
+  } else {
+    std::string line;
+    std::getline(file, line);
+    header << "# " << type << "\n";
+  }
+
+#define FPTLIN_ADT_SWITCH(ADT, ...)                                          \
+  if (type == #ADT) {                                                        \
+    history_t<pack_type<__VA_ARGS__>> hist;                                  \
+    {                                                                        \
+      scoped_phase phase(parse_stats, Phase::PARSE);                         \
+      hist = history_reader::read_hist<__VA_ARGS__>(*in);                    \
+    }                                                                        \
+    minimizer<pack_type<__VA_ARGS__>> m(                                     \
+        [strategy](auto candidate, const monitor_limits& candidate_limits) { \
+          thread_local checker hist_checker;                                 \
+          hist_checker.limits = candidate_limits;                            \
+          hist_checker.strategy = strategy;                                  \
+          return hist_checker.check_##ADT(candidate);                        \
+        },                                                                   \
+        limits, jobs);                                                       \
+    start = hr_clock::now();                                                 \
+    history_t<pack_type<__VA_ARGS__>> core = m.minimize(hist);               \
+    end = hr_clock::now();                                                   \
+    result = m.result;                                                       \
+    hist_size = hist.size();                                                 \
+    core_size = core.size();                                                 \
+    minimize_checks = m.checks;                                              \
+    if (!result.decided || result.linearizable) return;                      \
+                                                                             \
+    std::ofstream out_file;                                                  \
+    if (!output_file.empty()) {                                              \
+      out_file.open(output_file);                                            \
+      if (!out_file)                                                         \
+        throw std::invalid_argument("Failed to write " + output_file);       \
+    }                                                                        \
+    std::ostream& out = output_file.empty() ? std::cout : out_file;          \
+    out << header.str();                                                     \
+    write_operations(out, core, prefix);                                     \
+    return;                                                                  \
+  }
+  FPTLIN_ADT_EXPAND(FPTLIN_ADT_SWITCH)
+#undef FPTLIN_ADT_SWITCH
+
+  throw std::invalid_argument("Unknown data type '" + type + "'");
+}
+
+/**
+ * `incremental_state` of a history file, kept between runs by --incremental
+ * along with the bytes of the file it covers.
+ */
+struct incremental_file {
+  static constexpr std::string_view MAGIC = "FPTLININ";
+  static constexpr uint32_t VERSION = 1;
+
+  std::string type;
+
+  // bytes of the history covered, and a hash of the last of them to tell
+  // whether the file was rewritten since
+  std::streamoff offset = 0;
+  uint64_t tail = 0;
+
+  incremental_state state;
+
+  void save(const std::string& path) const {
+    checkpoint_writer w;
+    w.put(VERSION);
+    w.put(type);
+    w.put(offset);
+    w.put(tail);
+    w.put(state.ops);
+    w.put(state.last_end);
+    w.put(state.linearizable);
+    w.put(state.model);
+    replace_file(path, std::string(MAGIC) + w.data);
+  }
+
+  static incremental_file load(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    std::string data{std::istreambuf_iterator<char>(f), {}};
+    if (!data.starts_with(MAGIC))
+      throw std::invalid_argument(path + " is not an incremental state");
+
+    checkpoint_reader r(std::string_view(data).substr(MAGIC.size()));
+    if (r.get<uint32_t>() != VERSION)
+      throw std::invalid_argument(path + " is of another version");
+    incremental_file inc;
+    inc.type = r.get<std::string>();
+    inc.offset = r.get<std::streamoff>();
+    inc.tail = r.get<uint64_t>();
+    inc.state.ops = r.get<std::size_t>();
+    inc.state.last_end = r.get<time_type>();
+    inc.state.linearizable = r.get<bool>();
+    inc.state.model = r.get<std::string>();
+    return inc;
+  }
+
+  // of up to 4 KiB of `path` before `offset`
+  static uint64_t tail_hash(const std::string& path, std::streamoff offset) {
+    std::streamoff size = std::min<std::streamoff>(offset, 4096);
+    std::ifstream f(path, std::ios::binary);
+    f.seekg(offset - size);
+    std::string data(size, '\0');
+    f.read(data.data(), size);
+    return fnv1a(std::string_view(data).substr(0, f.gcount()));
+  }
+};
+
+// checks the operations appended to `input_file` since the last check with the
+// same `state_path`
+void monitor_incremental(checker& hist_checker, const std::string& input_file,
+                         const std::string& state_path) {
+  history_reader reader(input_file);
+  hist_type = reader.get_type_s();
+
+  incremental_file inc;
+  if (std::filesystem::exists(state_path))
+    inc = incremental_file::load(state_path);
+  if (inc.type != hist_type ||
+      std::filesystem::file_size(input_file) < std::uintmax_t(inc.offset) ||
+      incremental_file::tail_hash(input_file, inc.offset) != inc.tail) {
+    inc = {};
+    inc.type = hist_type;
+  }
+
+#define FPTLIN_AADT_SWITCH(ADT, ...)                                     \
+  if (hist_type == #ADT) {                                               \
+    std::vector<std::streamoff> ends;                                    \
+    history_t<pack_type<__VA_ARGS__>> hist;                              \
+    for (bool fresh = inc.offset == 0;; fresh = true) {                  \
+      ends.clear();                                                      \
+      {                                                                  \
+        scoped_phase phase(parse_stats, Phase::PARSE);                   \
+        hist = reader.get_hist<__VA_ARGS__>(inc.offset, &ends);          \
+      }                                                                  \
+      hist_size = inc.state.ops + hist.size();                           \
+      start = hr_clock::now();                                           \
+      try {                                                              \
+        result = hist_checker.check_##ADT(hist, inc.state);              \
+      } catch (const overlapping_operation&) {                           \
+        /* appended operations overlap those covered, start over */     \
+        if (fresh) throw;                                                \
+        inc = {};                                                        \
+        inc.type = hist_type;                                            \
+        continue;                                                        \
+      }                                                                  \
+      end = hr_clock::now();                                             \
+      break;                                                             \
+    }                                                                    \
+    if (inc.state.advanced) {                                            \
+      inc.offset = ends[inc.state.advanced - 1];                         \
+      inc.tail = incremental_file::tail_hash(input_file, inc.offset);    \
+    }                                                                    \
+    inc.save(state_path);                                                \
+    result.stats += parse_stats;                                         \
+    return;                                                              \
+  }
+  FPTLIN_AADT_EXPAND(FPTLIN_AADT_SWITCH)
+#undef FPTLIN_AADT_SWITCH
+
+  throw std::invalid_argument("Data type '" + hist_type +
+                              "' cannot be checked incrementally");
+}
+
+// bytes, with an optional K, M or G suffix for powers of 1024
+std::size_t parse_size(const std::string& str) {
+  std::size_t pos;
+  std::size_t size = std::stoull(str, &pos);
+  std::string suffix = str.substr(pos);
+  if (suffix.empty()) return size;
+  if (suffix == "K") return size << 10;
+  if (suffix == "M") return size << 20;
+  if (suffix == "G") return size << 30;
+  throw std::invalid_argument("Unknown size suffix '" + suffix + "'");
+}
+
+// as a JSON object with the field names of `monitor_progress`
+void write_json(std::ostream& os, const monitor_progress& progress) {
+  os << "{\"nodes\":" << progress.nodes << ",\"layer\":" << progress.layer
+     << ",\"layers\":" << progress.layers
+     << ",\"dp_done\":" << progress.dp_done
+     << ",\"dp_entries\":" << progress.dp_entries << "}";
+}
+
+// the fields of `result` known once decided, without braces
+void write_json(std::ostream& os, const check_result& result,
+                int64_t time_micros, std::size_t size) {
+  os << "\"result\":";
+  if (result.decided)
+    os << result.linearizable;
+  else
+    os << "null";
+  os << ",\"time_taken\":" << (time_micros / 1e6) << ",\"size\":" << size;
+}
+
+// as a line telling how far a check that ran out of budget got
+void write_progress(std::ostream& os, const monitor_progress& p) {
+  os << "Budget exhausted after " << p.nodes << " nodes";
+  if (p.layers) os << ", at layer " << p.layer << " of " << p.layers;
+  if (p.dp_entries)
+    os << ", with " << p.dp_done << " of " << p.dp_entries << " DP entries";
+  os << ".\n";
+}
+
+// as a duration in nanoseconds
+std::chrono::nanoseconds parse_seconds(const std::string& str) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(std::stod(str)));
+}
 
 void print_usage() {
-  std::cout << "Usage: ./fptlin [-tvh] <history_file>\n"
+  std::cout << "Usage: ./fptlin [-tvh] [--stats=json] [--perf] "
+               "[--mem-limit=SIZE] [--timeout=SECONDS] [--max-nodes=N] "
+               "[--checkpoint=FILE] [--checkpoint-interval=SECONDS] "
+               "[--resume=FILE] [--incremental=FILE] [--cache=DIR] "
+               "[--engine=ENGINE] [--jobs=N] [--fail-fast] "
+               "[--minimize[=FILE]] [<history_file>]\n"
+            << "       ./fptlin --serve[=SOCKET] [--jobs=N] [--mem-limit=SIZE] "
+               "[--timeout=SECONDS] [--max-nodes=N] [--cache=DIR] "
+               "[--engine=ENGINE]\n"
             << "Options:\n"
             << "  -t\treport time taken in seconds\n"
             << "  -v\tprint verbose information\n"
-            << "  -h\tinclude headers\n";
+            << "  -h\tinclude headers\n"
+            << "  --stats=json\n"
+            << "\tprint the result with per-phase timings and engine counters "
+               "as a JSON object\n"
+            << "  --perf\tadd per-phase hardware counters to --stats=json\n"
+            << "  --mem-limit=SIZE\n"
+            << "\tbound the nodes remembered by the search to SIZE bytes, "
+               "with an\n\toptional K, M or G suffix, exploring evicted ones "
+               "again\n"
+            << "  --timeout=SECONDS\n"
+            << "  --max-nodes=N\n"
+            << "\tgive up after SECONDS or N nodes of search, reporting "
+               "`unknown'\n\twith exit status 2\n"
+            << "  --checkpoint=FILE\n"
+            << "\tsave the state of the search to FILE every minute, when a "
+               "budget runs\n\tout and on SIGINT or SIGTERM\n"
+            << "  --checkpoint-interval=SECONDS\n"
+            << "\tsave every SECONDS instead\n"
+            << "  --resume=FILE\n"
+            << "\tcontinue the check saved to FILE, of <history_file> or "
+               "else of the\n\thistory it was taken from, checkpointing to "
+               "FILE unless --checkpoint\n\tis given\n"
+            << "  --incremental=FILE\n"
+            << "\tonly check what was appended to the history since the "
+               "last run with\n\tthe same FILE, for data types checked by "
+               "the aadt search\n"
+            << "  --cache=DIR\n"
+            << "\ttake the result from DIR if the same history, up to its "
+               "timestamps and\n\tprocess ids, was checked with it before, "
+               "and keep it there otherwise\n"
+            << "  --engine=ENGINE\n"
+            << "\tdecide what the greedy and other cheap engines leave open "
+               "with `fpt',\n\tthe engine of the data type exponential in "
+               "the number of processes,\n\t`jit', a just-in-time "
+               "linearization search, `auto', the one expected\n\tto be "
+               "faster (default), or `race', both at once\n"
+            << "  --jobs=N\n"
+            << "\tcheck the objects of a history of several, or the requests "
+               "of --serve,\n\ton N threads, one per hardware thread by "
+               "default\n"
+            << "  --fail-fast\n"
+            << "\tstop checking the other objects of a history once one is "
+               "not\n\tlinearizable\n"
+            << "  --minimize[=FILE]\n"
+            << "\twrite a small part of a history that is not linearizable "
+               "to FILE, or\n\tstdout, in its format, which is not either "
+               "but is without any one of\n\tits operations, checking "
+               "candidates on --jobs threads; budgets apply\n\tto each "
+               "check, with those left undecided taken as linearizable\n"
+            << "  --serve[=SOCKET]\n"
+            << "\tanswer requests from stdin, or from clients of the UNIX "
+               "domain socket\n\tSOCKET\n";
 }
 
 int main(int argc, char* argv[]) {
-  const char* titles[]{"result", "time_taken", "size", "exclude_peeks"};
-  bool to_print[]{true, false, false};
-  auto& [_, print_time, print_size] = to_print;
+  const char* titles[]{"result", "time_taken", "size", "engine"};
+  bool to_print[]{true, false, false, false};
+  auto& [_, print_time, print_size, print_engine] = to_print;
   bool print_header = false;
+  bool print_stats = false;
+  bool read_perf = false;
+  monitor_limits limits;
+  checkpoint_options checkpoints;
+  std::optional<checkpoint> resume;
+  std::string incremental_path;
+  std::string cache_dir;
+  Strategy strategy = Strategy::AUTO;
+  std::optional<serve_options> serving;
+  std::size_t jobs = 0;
+  bool fail_fast = false;
+  std::optional<std::string> minimize_output;
   std::string input_file;
 
   if (argc <= 1) {
@@ -68,12 +530,130 @@ int main(int argc, char* argv[]) {
 
   int flag;
   int long_optind;
-  static struct option long_options[] = {{"help", no_argument, 0, 0},
-                                         {0, 0, 0, 0}};
+  static struct option long_options[] = {
+      {"help", no_argument, 0, 0},
+      {"stats", required_argument, 0, 0},
+      {"perf", no_argument, 0, 0},
+      {"mem-limit", required_argument, 0, 0},
+      {"timeout", required_argument, 0, 0},
+      {"max-nodes", required_argument, 0, 0},
+      {"checkpoint", required_argument, 0, 0},
+      {"checkpoint-interval", required_argument, 0, 0},
+      {"resume", required_argument, 0, 0},
+      {"incremental", required_argument, 0, 0},
+      {"cache", required_argument, 0, 0},
+      {"engine", required_argument, 0, 0},
+      {"serve", optional_argument, 0, 0},
+      {"jobs", required_argument, 0, 0},
+      {"fail-fast", no_argument, 0, 0},
+      {"minimize", optional_argument, 0, 0},
+      {0, 0, 0, 0}};
   while ((flag = getopt_long(argc, argv, "txvh", long_options, &long_optind)) !=
          -1)
     switch (flag) {
       case 0:
+        if (long_options[long_optind].name == std::string("stats")) {
+          if (optarg != std::string("json")) {
+            std::cerr << "Unknown stats format `" << optarg << "'.\n";
+            exit(EXIT_FAILURE);
+          }
+          print_stats = true;
+          break;
+        }
+        if (long_options[long_optind].name == std::string("perf")) {
+          print_stats = read_perf = true;
+          break;
+        }
+        if (long_options[long_optind].name == std::string("mem-limit")) {
+          try {
+            limits.mem_limit = parse_size(optarg);
+          } catch (const std::exception&) {
+            std::cerr << "Invalid memory limit `" << optarg << "'.\n";
+            exit(EXIT_FAILURE);
+          }
+          break;
+        }
+        if (long_options[long_optind].name == std::string("timeout")) {
+          try {
+            limits.timeout = parse_seconds(optarg);
+          } catch (const std::exception&) {
+            std::cerr << "Invalid timeout `" << optarg << "'.\n";
+            exit(EXIT_FAILURE);
+          }
+          break;
+        }
+        if (long_options[long_optind].name == std::string("max-nodes")) {
+          try {
+            limits.max_nodes = std::stoull(optarg);
+          } catch (const std::exception&) {
+            std::cerr << "Invalid node budget `" << optarg << "'.\n";
+            exit(EXIT_FAILURE);
+          }
+          break;
+        }
+        if (long_options[long_optind].name == std::string("checkpoint")) {
+          checkpoints.path = optarg;
+          break;
+        }
+        if (long_options[long_optind].name ==
+            std::string("checkpoint-interval")) {
+          try {
+            checkpoints.interval = parse_seconds(optarg);
+          } catch (const std::exception&) {
+            std::cerr << "Invalid checkpoint interval `" << optarg << "'.\n";
+            exit(EXIT_FAILURE);
+          }
+          break;
+        }
+        if (long_options[long_optind].name == std::string("resume")) {
+          try {
+            resume = checkpoint::load(optarg);
+          } catch (const std::exception& e) {
+            std::cerr << e.what() << ".\n";
+            exit(EXIT_FAILURE);
+          }
+          if (checkpoints.path.empty()) checkpoints.path = optarg;
+          break;
+        }
+        if (long_options[long_optind].name == std::string("incremental")) {
+          incremental_path = optarg;
+          break;
+        }
+        if (long_options[long_optind].name == std::string("cache")) {
+          cache_dir = optarg;
+          break;
+        }
+        if (long_options[long_optind].name == std::string("engine")) {
+          try {
+            strategy = stostrategy(optarg);
+          } catch (const std::exception&) {
+            std::cerr << "Unknown engine `" << optarg << "'.\n";
+            exit(EXIT_FAILURE);
+          }
+          break;
+        }
+        if (long_options[long_optind].name == std::string("serve")) {
+          serving.emplace();
+          if (optarg) serving->socket = optarg;
+          break;
+        }
+        if (long_options[long_optind].name == std::string("jobs")) {
+          try {
+            jobs = std::stoull(optarg);
+          } catch (const std::exception&) {
+            std::cerr << "Invalid number of jobs `" << optarg << "'.\n";
+            exit(EXIT_FAILURE);
+          }
+          break;
+        }
+        if (long_options[long_optind].name == std::string("fail-fast")) {
+          fail_fast = true;
+          break;
+        }
+        if (long_options[long_optind].name == std::string("minimize")) {
+          minimize_output = optarg ? optarg : "";
+          break;
+        }
         print_usage();
         exit(EXIT_SUCCESS);
       case 't':
@@ -91,29 +671,208 @@ int main(int argc, char* argv[]) {
       default:
         abort();
     }
+  if (serving) {
+    serving->jobs = jobs;
+    serving->limits = limits;
+    serving->cache = cache_dir;
+    serving->strategy = strategy;
+    return serve(*serving);
+  }
+
   if (optind < argc)
     input_file = argv[optind];
+  else if (resume)
+    input_file = resume->source;
   else {
     std::cout << "Please provide a file path\n";
     exit(EXIT_FAILURE);
   }
 
-  monitor(input_file);
+  if (!incremental_path.empty() && !checkpoints.path.empty()) {
+    std::cerr << "--incremental cannot be combined with --checkpoint or "
+                 "--resume.\n";
+    exit(EXIT_FAILURE);
+  }
+  if (strategy == Strategy::JIT && !checkpoints.path.empty()) {
+    std::cerr << "--engine=jit cannot be combined with --checkpoint or "
+                 "--resume.\n";
+    exit(EXIT_FAILURE);
+  }
+  if (!incremental_path.empty() && !cache_dir.empty()) {
+    std::cerr << "--incremental cannot be combined with --cache.\n";
+    exit(EXIT_FAILURE);
+  }
+
+  if (minimize_output &&
+      (!incremental_path.empty() || !checkpoints.path.empty())) {
+    std::cerr << "--minimize cannot be combined with --incremental, "
+                 "--checkpoint or --resume.\n";
+    exit(EXIT_FAILURE);
+  }
+  if (minimize_output && print_stats) {
+    std::cerr << "--minimize cannot be combined with --stats.\n";
+    exit(EXIT_FAILURE);
+  }
+
+  bool several = history_reader(input_file).get_type_s() == OBJECTS_TYPE;
+  if (several && !checkpoints.path.empty()) {
+    std::cerr << "Histories of several objects cannot be checkpointed.\n";
+    exit(EXIT_FAILURE);
+  }
+  // counters are read on the thread that opens them, and objects are checked
+  // on threads of their own
+  if (several && read_perf) {
+    std::cerr << "--perf cannot be combined with histories of several "
+                 "objects.\n";
+    exit(EXIT_FAILURE);
+  }
+
+  if (!cache_dir.empty()) {
+    try {
+      cache.emplace(cache_dir);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << ".\n";
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  std::optional<perf_counters> perf;
+  if (read_perf) {
+    perf.emplace();
+    if (!perf->available())
+      std::cerr << "Hardware counters are unavailable, see "
+                   "/proc/sys/kernel/perf_event_paranoid.\n";
+  }
+
+#ifdef FPTLIN_STATS
+  parse_stats.perf = perf ? &*perf : nullptr;
+#endif
+
+  if (!checkpoints.path.empty()) {
+    checkpoints.source = std::filesystem::absolute(input_file);
+    limits.stop = &stop_requested;
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+  }
+
+  checker hist_checker(perf ? &*perf : nullptr);
+  hist_checker.limits = limits;
+  hist_checker.checkpoints = checkpoints;
+  hist_checker.strategy = strategy;
+  hist_checker.resume = std::move(resume);
+  try {
+    if (minimize_output)
+      minimize(input_file, *minimize_output, limits, strategy, jobs);
+    else if (!incremental_path.empty())
+      monitor_incremental(hist_checker, input_file, incremental_path);
+    else if (several)
+      monitor_objects(input_file, limits, strategy, jobs, fail_fast);
+    else
+      monitor(hist_checker, input_file);
+  } catch (const std::invalid_argument& e) {
+    std::cerr << e.what() << ".\n";
+    exit(EXIT_FAILURE);
+  }
+
+  // the core instead of the result, unless there is none
+  if (minimize_output && result.decided && !result.linearizable) {
+    if (print_time || print_size)
+      std::cerr << "Minimized " << hist_size << " operations to "
+                << core_size << " with " << minimize_checks << " checks in "
+                << std::chrono::duration<double>(end - start).count()
+                << " seconds.\n";
+    return 0;
+  }
+
+  // a checkpoint is of no use once the result is known
+  if (result.decided && !checkpoints.path.empty())
+    std::filesystem::remove(checkpoints.path);
 
   int64_t time_micros =
       std::chrono::duration_cast<std::chrono::microseconds>(end - start)
           .count();
 
+  if (print_stats) {
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+      result.stats.set_max(Counter::PEAK_RSS_KB, usage.ru_maxrss);
+
+    std::cout << "{";
+    if (several) {
+      write_json(std::cout, result, time_micros, hist_size);
+      std::cout << ",\"objects\":[";
+      for (const object_result& o : objects) {
+        std::cout << (&o == objects.data() ? "" : ",") << "{\"object\":\""
+                  << o.id << "\",";
+        write_json(std::cout, o.result,
+                   std::chrono::duration_cast<std::chrono::microseconds>(
+                       o.time)
+                       .count(),
+                   o.size);
+        std::cout << ",\"engine\":\"" << enginetos(o.result.engine)
+                  << "\",\"cached\":" << (o.cached ? "true" : "false")
+                  << ",\"progress\":";
+        write_json(std::cout, o.result.progress);
+        std::cout << ",";
+        write_json(std::cout, o.result.stats);
+        std::cout << "}";
+      }
+      std::cout << "]";
+    } else {
+      write_json(std::cout, result, time_micros, hist_size);
+      std::cout << ",\"engine\":\"" << enginetos(result.engine)
+                << "\",\"cached\":" << (cached ? "true" : "false")
+                << ",\"progress\":";
+      write_json(std::cout, result.progress);
+    }
+    std::cout << ",";
+    write_json(std::cout, result.stats);
+    std::cout << "}" << std::endl;
+    return result.decided ? 0 : EXIT_UNDECIDED;
+  }
+
+  // of histories of several objects, one line per object, starting with its
+  // id, before the line of the whole history, which has no engine
   if (print_header) {
+    if (several) std::cout << "object ";
     for (size_t i = 0; i < sizeof(to_print); ++i)
       if (to_print[i]) std::cout << titles[i] << " ";
     std::cout << "\n";
   }
 
-  std::cout << result << " ";
-  if (print_time) std::cout << (time_micros / 1e6) << " ";
-  if (print_size) std::cout << hist_size << " ";
-  std::cout << std::endl;
+  auto print_row = [&](const check_result& r, int64_t micros, size_t size,
+                       bool engine) {
+    if (r.decided)
+      std::cout << r.linearizable << " ";
+    else
+      std::cout << "unknown ";
+    if (print_time) std::cout << (micros / 1e6) << " ";
+    if (print_size) std::cout << size << " ";
+    if (engine) std::cout << enginetos(r.engine) << " ";
+    std::cout << std::endl;
+  };
+  for (const object_result& o : objects) {
+    std::cout << o.id << " ";
+    print_row(o.result,
+              std::chrono::duration_cast<std::chrono::microseconds>(o.time)
+                  .count(),
+              o.size, print_engine);
+  }
+  print_row(result, time_micros, hist_size, print_engine && !several);
 
+  if (!result.decided) {
+    if (several) {
+      for (const object_result& o : objects) {
+        if (o.result.decided) continue;
+        std::cerr << "Object '" << o.id << "': ";
+        write_progress(std::cerr, o.result.progress);
+      }
+      return EXIT_UNDECIDED;
+    }
+    write_progress(std::cerr, result.progress);
+    if (!checkpoints.path.empty() && std::filesystem::exists(checkpoints.path))
+      std::cerr << "Resume with --resume=" << checkpoints.path << ".\n";
+    return EXIT_UNDECIDED;
+  }
   return 0;
-}
\ No newline at end of file
+}
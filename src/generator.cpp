@@ -0,0 +1,95 @@
+#include <getopt.h>
+
+#include <iostream>
+#include <random>
+
+#include "history_generator.h"
+
+using namespace fptlin;
+
+void generate(const std::string& type, const generator::params& p) {
+  std::mt19937_64 rng(p.seed);
+
+#define FPTLIN_ADT_GENERATE(ADT, ...)                 \
+  if (type == #ADT) {                                 \
+    auto seq = generator::sequence_##ADT(rng, p);     \
+    auto hist = generator::shape(rng, p, seq);        \
+    write_history(std::cout, type, hist);            \
+    return;                                           \
+  }
+  FPTLIN_ADT_EXPAND(FPTLIN_ADT_GENERATE)
+#undef FPTLIN_ADT_GENERATE
+
+  throw std::invalid_argument("Unknown data type '" + type + "'");
+}
+
+void print_usage() {
+  std::cout << "Usage: ./fptlin_gen [-n size] [-k procs] [-o overlap] "
+               "[-v values] [-s seed] [--nonlin] <data_type>\n"
+            << "Options:\n"
+            << "  -n\tnumber of operations (default 100)\n"
+            << "  -k\tnumber of processes (default 4)\n"
+            << "  -o\tmean reach of an interval around its linearization "
+               "point,\n\tin gaps between consecutive points (default 1)\n"
+            << "  -v\tdraw values from [0, values), 0 for unique values "
+               "(default 0)\n"
+            << "  -s\trandom seed (default 1)\n"
+            << "  --nonlin\tgenerate a non-linearizable history\n";
+}
+
+int main(int argc, char* argv[]) {
+  generator::params p;
+
+  if (argc <= 1) {
+    print_usage();
+    exit(EXIT_SUCCESS);
+  }
+
+  int flag;
+  int long_optind;
+  static struct option long_options[] = {{"help", no_argument, 0, 0},
+                                         {"nonlin", no_argument, 0, 0},
+                                         {0, 0, 0, 0}};
+  while ((flag = getopt_long(argc, argv, "n:k:o:v:s:", long_options,
+                             &long_optind)) != -1)
+    switch (flag) {
+      case 0:
+        if (long_options[long_optind].name == std::string("nonlin")) {
+          p.linearizable = false;
+          break;
+        }
+        print_usage();
+        exit(EXIT_SUCCESS);
+      case 'n':
+        p.size = std::stoull(optarg);
+        break;
+      case 'k':
+        p.procs = std::stoul(optarg);
+        break;
+      case 'o':
+        p.overlap = std::stod(optarg);
+        break;
+      case 'v':
+        p.values = std::stoull(optarg);
+        break;
+      case 's':
+        p.seed = std::stoull(optarg);
+        break;
+      case '?':
+        std::cerr << "Unknown option `" << optopt << "'.\n";
+        exit(EXIT_FAILURE);
+      default:
+        abort();
+    }
+  if (optind >= argc) {
+    std::cout << "Please provide a data type\n";
+    exit(EXIT_FAILURE);
+  }
+  if (p.procs == 0) {
+    std::cerr << "Process count must be positive.\n";
+    exit(EXIT_FAILURE);
+  }
+
+  generate(argv[optind], p);
+  return 0;
+}
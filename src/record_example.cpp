@@ -0,0 +1,127 @@
+#include <getopt.h>
+
+#include <chrono>
+#include <iostream>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "checker.h"
+#include "history_recorder.h"
+
+using namespace fptlin;
+
+// a stack shared by the threads; with `racy`, a pop reads the top and removes
+// it under two locks, so that two pops may return the same value
+class shared_stack {
+ public:
+  explicit shared_stack(bool racy) : racy(racy) {}
+
+  void push(int value) {
+    std::lock_guard lock(mutex);
+    values.push_back(value);
+  }
+
+  int pop() {
+    std::unique_lock lock(mutex);
+    if (values.empty()) return EMPTY_VALUE;
+    int value = values.back();
+    if (racy) {
+      lock.unlock();
+      std::this_thread::sleep_for(std::chrono::microseconds(1));
+      lock.lock();
+      if (values.empty()) return value;
+    }
+    values.pop_back();
+    return value;
+  }
+
+ private:
+  bool racy;
+  std::mutex mutex;
+  std::vector<int> values;
+};
+
+// records `ops` operations of each of `procs` threads on a stack, and checks
+// the history
+void record(proc_type procs, std::size_t ops, bool racy) {
+  shared_stack stack(racy);
+  history_recorder<int> recorder(procs, ops);
+
+  // the threads start at once, so that their operations overlap
+  std::latch ready(procs);
+  std::vector<std::thread> threads;
+  for (proc_type p = 0; p < procs; ++p)
+    threads.emplace_back([&, p] {
+      ready.arrive_and_wait();
+      for (std::size_t i = 0; i < ops; ++i) {
+        auto op = recorder.invoke(p);
+        if (i % 2 == 0) {
+          int value = int(p * ops + i);
+          stack.push(value);
+          recorder.respond(op, Method::PUSH, value);
+        } else {
+          int value = stack.pop();
+          recorder.respond(op, Method::POP, value);
+        }
+      }
+    });
+  for (std::thread& t : threads) t.join();
+
+  history_t<int> hist = recorder.flush();
+  checker hist_checker;
+  check_result result = hist_checker.check_stack(hist);
+  std::cout << result.linearizable << ' ' << hist.size() << ' '
+            << enginetos(result.engine) << '\n';
+}
+
+void print_usage() {
+  std::cout << "Usage: ./fptlin_record_example [-k procs] [-n ops] [--racy]\n"
+            << "Options:\n"
+            << "  -k\tnumber of threads (default 4)\n"
+            << "  -n\toperations per thread (default 1000)\n"
+            << "  --racy\tpop without holding the lock throughout\n";
+}
+
+int main(int argc, char* argv[]) {
+  proc_type procs = 4;
+  std::size_t ops = 1000;
+  bool racy = false;
+
+  int flag;
+  int long_optind;
+  static struct option long_options[] = {{"help", no_argument, 0, 0},
+                                         {"racy", no_argument, 0, 0},
+                                         {0, 0, 0, 0}};
+  while ((flag = getopt_long(argc, argv, "k:n:", long_options,
+                             &long_optind)) != -1)
+    switch (flag) {
+      case 0:
+        if (long_options[long_optind].name == std::string("racy")) {
+          racy = true;
+          break;
+        }
+        print_usage();
+        exit(EXIT_SUCCESS);
+      case 'k':
+        procs = std::stoul(optarg);
+        break;
+      case 'n':
+        ops = std::stoull(optarg);
+        break;
+      case '?':
+        std::cerr << "Unknown option `" << optopt << "'.\n";
+        exit(EXIT_FAILURE);
+      default:
+        abort();
+    }
+
+  try {
+    record(procs, ops, racy);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
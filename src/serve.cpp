@@ -0,0 +1,359 @@
+#include "serve.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+#include "checker.h"
+#include "history_reader.h"
+#include "result_cache.h"
+#include "thread_pool.h"
+
+using namespace fptlin;
+
+namespace {
+
+/**
+ * Requests and responses of one client. Requests are read by one thread,
+ * while responses may be written by any.
+ */
+class session {
+ public:
+  // `in` and `out` are closed with the session if `owned`
+  session(int in, int out, bool owned) : in(in), out(out), owned(owned) {}
+
+  ~session() {
+    if (!owned) return;
+    close(in);
+    if (out != in) close(out);
+  }
+
+  session(const session&) = delete;
+  session& operator=(const session&) = delete;
+
+  // the next line without its newline, false at the end of the input
+  bool read_line(std::string& line) {
+    for (;;) {
+      std::size_t newline = buffer.find('\n', pos);
+      if (newline != std::string::npos) {
+        line.assign(buffer, pos, newline - pos);
+        pos = newline + 1;
+        return true;
+      }
+      buffer.erase(0, pos);
+      pos = 0;
+
+      char chunk[1 << 16];
+      ssize_t n = read(in, chunk, sizeof(chunk));
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) {
+        // a last line without a newline
+        if (buffer.empty()) return false;
+        line = std::move(buffer);
+        buffer.clear();
+        return true;
+      }
+      buffer.append(chunk, n);
+    }
+  }
+
+  // writes `line` and a newline at once, so that responses to requests
+  // answered concurrently do not interleave
+  void respond(std::string line) {
+    line += '\n';
+    std::lock_guard lock(out_mutex);
+    for (std::size_t done = 0; done < line.size();) {
+      ssize_t n = write(out, line.data() + done, line.size() - done);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return;  // the client is gone
+      done += n;
+    }
+  }
+
+  // ends `read_line` of a socket from another thread
+  void stop_reading() { shutdown(in, SHUT_RD); }
+
+ private:
+  int in, out;
+  bool owned;
+  std::string buffer;
+  std::size_t pos = 0;
+  std::mutex out_mutex;
+};
+
+struct request {
+  std::string id;
+
+  // of the history, or else the history itself
+  std::string path;
+  std::string text;
+};
+
+// of a history checked by `check_history`
+struct checked {
+  check_result result{false, false, Engine::GREEDY, {}, {}};
+  std::size_t size = 0;
+  std::chrono::nanoseconds time{};
+};
+
+// checks the history of `type` read from `in` with `hist_checker`, unless
+// found in `cache`
+checked check_history(checker& hist_checker, const std::string& type,
+                      std::istream& in, const result_cache* cache) {
+  checked res;
+#define FPTLIN_ADT_SWITCH(ADT, ...)                                        \
+  if (type == #ADT) {                                                      \
+    history_t<pack_type<__VA_ARGS__>> hist =                               \
+        history_reader::read_hist<__VA_ARGS__>(in);                        \
+    res.size = hist.size();                                                \
+    auto check = [&] { return hist_checker.check_##ADT(hist); };           \
+    if (cache) {                                                           \
+      auto key = result_cache::key<pack_type<__VA_ARGS__>>(type, hist);    \
+      result_cache::entry e = cache->get_or_check(key, check).first;       \
+      res.result = e.result;                                               \
+      res.time = e.time;                                                   \
+    } else {                                                               \
+      auto start = std::chrono::steady_clock::now();                       \
+      res.result = check();                                                \
+      res.time = std::chrono::steady_clock::now() - start;                 \
+    }                                                                      \
+    return res;                                                            \
+  }
+  FPTLIN_ADT_EXPAND(FPTLIN_ADT_SWITCH)
+#undef FPTLIN_ADT_SWITCH
+  throw std::invalid_argument("Unknown data type '" + type + "'");
+}
+
+// as `check_history`, of each object of a history of `OBJECTS_TYPE` in turn,
+// on the thread of the request, until one is not linearizable; the engine is
+// that of the object that settles the result, or else of the slowest
+checked check_objects(checker& hist_checker, std::istream& in,
+                      const result_cache* cache) {
+  checked res;
+  res.result = {true, true, Engine::GREEDY, {}, {}};
+  std::chrono::nanoseconds slowest{-1};
+  for (const object_history& o : history_reader::read_objects(in)) {
+    std::istringstream ops(o.ops);
+    checked r;
+    try {
+      r = check_history(hist_checker, o.type, ops, cache);
+    } catch (const std::invalid_argument& e) {
+      throw std::invalid_argument(std::string(e.what()) + " of object '" +
+                                  o.id + "'");
+    }
+    res.size += r.size;
+    res.time += r.time;
+    if (!r.result.decided) {
+      if (res.result.decided) res.result.engine = r.result.engine;
+      res.result.decided = false;
+    } else if (!r.result.linearizable) {
+      res.result = {false, true, r.result.engine, {}, {}};
+      break;
+    } else if (res.result.decided && r.time > slowest) {
+      res.result.engine = r.result.engine;
+      slowest = r.time;
+    }
+  }
+  return res;
+}
+
+// the response to `req`, checked by the `checker` of the calling thread, which
+// keeps its buffers across requests, unless found in `cache`
+std::string answer(const request& req, const serve_options& options,
+                   const result_cache* cache) {
+  thread_local checker hist_checker;
+  hist_checker.limits = options.limits;
+  hist_checker.strategy = options.strategy;
+
+  try {
+    std::ifstream file;
+    std::istringstream text;
+    std::istream* in = &text;
+    if (req.path.empty()) {
+      text.str(req.text);
+    } else {
+      file.open(req.path);
+      if (!file) throw std::invalid_argument("Failed to read " + req.path);
+      in = &file;
+    }
+    std::string line;
+    std::getline(*in, line);
+    std::string type = history_reader::read_type(line);
+    checked res = type == OBJECTS_TYPE
+                      ? check_objects(hist_checker, *in, cache)
+                      : check_history(hist_checker, type, *in, cache);
+
+    std::ostringstream os;
+    os << req.id << " ";
+    if (res.result.decided)
+      os << res.result.linearizable;
+    else
+      os << "unknown";
+    int64_t time_micros =
+        std::chrono::duration_cast<std::chrono::microseconds>(res.time)
+            .count();
+    os << " " << (time_micros / 1e6) << " " << res.size << " "
+       << enginetos(res.result.engine);
+    return os.str();
+  } catch (const std::exception& e) {
+    return req.id + " error " + e.what();
+  }
+}
+
+// reads the requests of `s` until its end, and submits them to `pool`
+void run_session(std::shared_ptr<session> s, thread_pool& pool,
+                 const serve_options& options, const result_cache* cache) {
+  std::string line;
+  while (s->read_line(line)) {
+    std::istringstream ss(line);
+    request req;
+    std::string kind;
+    if (!(ss >> req.id)) continue;
+    ss >> kind;
+
+    if (kind == "FILE") {
+      std::getline(ss >> std::ws, req.path);
+      if (req.path.empty()) {
+        s->respond(req.id + " error Missing path");
+        continue;
+      }
+    } else if (kind == "BEGIN") {
+      bool ended = false;
+      while (s->read_line(line)) {
+        if (line == "END") {
+          ended = true;
+          break;
+        }
+        req.text += line;
+        req.text += '\n';
+      }
+      if (!ended) {
+        s->respond(req.id + " error Missing END");
+        break;
+      }
+    } else {
+      s->respond(req.id + " error Unknown request '" + kind + "'");
+      continue;
+    }
+
+    pool.submit([s, req = std::move(req), &options, cache] {
+      s->respond(answer(req, options, cache));
+    });
+  }
+}
+
+std::atomic<bool> stop_requested;
+
+void request_stop(int) { stop_requested = true; }
+
+int listen_on(const std::string& path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+    throw std::invalid_argument("Socket path is too long");
+  std::strcpy(addr.sun_path, path.c_str());
+
+  // left behind by a previous server
+  std::error_code ec;
+  if (std::filesystem::is_socket(path, ec)) unlink(path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+      listen(fd, SOMAXCONN) < 0)
+    throw std::system_error(errno, std::generic_category(),
+                            "Failed to listen on " + path);
+  return fd;
+}
+
+}  // namespace
+
+int serve(const serve_options& options) {
+  std::optional<result_cache> cache;
+  try {
+    if (!options.cache.empty()) cache.emplace(options.cache);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << ".\n";
+    return EXIT_FAILURE;
+  }
+  const result_cache* shared_cache = cache ? &*cache : nullptr;
+
+  if (options.socket.empty()) {
+    thread_pool pool(options.jobs);
+    run_session(std::make_shared<session>(STDIN_FILENO, STDOUT_FILENO, false),
+                pool, options, shared_cache);
+    return EXIT_SUCCESS;
+  }
+
+  int fd;
+  try {
+    fd = listen_on(options.socket);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << ".\n";
+    return EXIT_FAILURE;
+  }
+
+  // only this thread takes the signals, without SA_RESTART, so that `accept`
+  // returns on them
+  sigset_t stops;
+  sigemptyset(&stops);
+  sigaddset(&stops, SIGINT);
+  sigaddset(&stops, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stops, nullptr);
+  thread_pool pool(options.jobs);
+
+  struct sigaction action{};
+  action.sa_handler = request_stop;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  pthread_sigmask(SIG_UNBLOCK, &stops, nullptr);
+
+  // a session ends, closing its socket, once its requests are read and
+  // answered
+  struct client {
+    std::weak_ptr<session> s;
+    std::thread reader;
+  };
+  std::list<client> clients;
+  while (!stop_requested) {
+    int conn = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (conn < 0) continue;
+
+    std::erase_if(clients, [](client& c) {
+      if (!c.s.expired()) return false;
+      c.reader.join();
+      return true;
+    });
+    auto s = std::make_shared<session>(conn, conn, true);
+    clients.push_back(
+        {s, std::thread([s, &pool, &options, shared_cache, stops] {
+           pthread_sigmask(SIG_BLOCK, &stops, nullptr);
+           run_session(s, pool, options, shared_cache);
+         })});
+    s.reset();
+  }
+
+  close(fd);
+  unlink(options.socket.c_str());
+  // requests already read are still answered, by the destructor of `pool`
+  for (client& c : clients) {
+    if (auto s = c.s.lock()) s->stop_reading();
+    c.reader.join();
+  }
+  return EXIT_SUCCESS;
+}
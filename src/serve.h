@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "monitor_context.h"
+
+struct serve_options {
+  // UNIX domain socket to listen on, stdin and stdout if empty
+  std::string socket;
+
+  // threads checking requests, 0 for one per hardware thread
+  std::size_t jobs = 0;
+
+  // applied to every request
+  fptlin::monitor_limits limits;
+
+  // directory of a `result_cache` shared by all requests, none if empty
+  std::string cache;
+
+  fptlin::Strategy strategy = fptlin::Strategy::AUTO;
+};
+
+/**
+ * Answers requests for checks until the end of stdin, or until SIGINT or
+ * SIGTERM when listening on a socket, with each client a session of its own.
+ *
+ * Requests are lines, answered in the order they complete:
+ *
+ *   <id> FILE <path>        check the history at <path>
+ *   <id> BEGIN              check the history on the following lines, up to a
+ *   ...                     line `END`, starting with its type as in files
+ *   END
+ *
+ * with `<id> <result> <time_taken> <size> <engine>`, as `fptlin -v` prints
+ * them, or `<id> error <message>`. The objects of a history of several are
+ * checked one after another, and answered with one line for all of them.
+ *
+ * Returns the exit status.
+ */
+int serve(const serve_options& options);